@@ -0,0 +1,377 @@
+#!/usr/bin/env python3
+import struct
+import sys
+from pathlib import Path
+
+MAGIC = b"gpkV3"  # 5 bytes
+NAME_LEN = 4
+ENTRY_SIZE = NAME_LEN + 2 + 2 + 4 + 1
+SECTOR_SIZE = 512
+
+ENCODING_SPANS = 0
+ENCODING_RAW = 1
+ENCODING_PAL4 = 2
+ENCODING_PAL8 = 3
+ENCODING_FILL = 4
+
+# the renderer keeps palettes in a RAM cache of GFX_PALETTE_CACHE_COLOURS colours, keep these in sync
+PAL4_MAX_COLOURS = 16
+PAL8_MAX_COLOURS = 64
+
+TRANSPARENT = 0x0000
+OPAQUE_BLACK = 0x0020  # darkest green, used so opaque black does not turn transparent
+MAX_RUN = 255
+MAX_RUNS_PER_ROW = 255
+# equal pixels in a row that are stored as a single colour, shorter stretches cost more in run headers than they save
+FILL_MIN_RUN = 8
+# assets that are always stored raw with black as an opaque colour, so they are streamed from the card as they are:
+# the fullscreen images HOMESCREEN and GAMEOVER_SCREEN from src/resources.h. More can be added with --raw
+RAW_ASSETS = {"Q", "R"}
+
+
+def rgb565(r, g, b):
+    return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3)
+
+
+def load_bmp(path: Path):
+    """Loads an uncompressed 24 or 32 bit BMP and returns (width, height, rows), rows top to bottom."""
+    data = path.read_bytes()
+
+    if data[0:2] != b"BM":
+        raise ValueError(f"{path} is not a BMP file")
+
+    pixel_offset = struct.unpack_from("<I", data, 10)[0]
+    header_size = struct.unpack_from("<I", data, 14)[0]
+
+    if header_size == 12:
+        width, height, _, bpp = struct.unpack_from("<HHHH", data, 18)
+        compression = 0
+    else:
+        width, height, _, bpp, compression = struct.unpack_from("<iiHHI", data, 18)
+
+    if bpp not in (24, 32) or compression not in (0, 3):
+        raise ValueError(f"{path}: only uncompressed 24/32 bit BMPs are supported")
+
+    top_down = height < 0
+    height = abs(height)
+    bytes_per_pixel = bpp // 8
+    row_size = ((width * bytes_per_pixel) + 3) & ~3
+
+    rows = []
+    for y in range(height):
+        start = pixel_offset + y * row_size
+        row = []
+        for x in range(width):
+            b, g, r = data[start + x * bytes_per_pixel:start + x * bytes_per_pixel + 3]
+            row.append((r, g, b))
+        rows.append(row)
+
+    if not top_down:
+        rows.reverse()
+
+    return width, height, rows
+
+
+def load_sheet(paths):
+    """Loads one or more equally sized BMPs as a sprite sheet, the frames stacked from top to bottom."""
+    width, height, rows = load_bmp(paths[0])
+
+    for path in paths[1:]:
+        frame_width, frame_height, frame_rows = load_bmp(path)
+        if (frame_width, frame_height) != (width, height):
+            raise ValueError(f"{path}: every frame of a sheet must have the size of the first frame")
+        rows += frame_rows
+
+    return width, len(rows), rows
+
+
+def convert_rows(rows):
+    """Converts RGB888 rows to RGB565, keeping (0, 0, 0) as the only transparent colour."""
+    out = []
+    for row in rows:
+        converted = []
+        for (r, g, b) in row:
+            if (r | g | b) == 0:
+                converted.append(TRANSPARENT)
+            else:
+                colour = rgb565(r, g, b)
+                converted.append(colour if colour != TRANSPARENT else OPAQUE_BLACK)
+        out.append(converted)
+    return out
+
+
+def find_runs(row):
+    """Splits a row into (skip, length) pairs, skip being the transparent pixels before the opaque run."""
+    runs = []
+    x = 0
+    skip = 0
+    while x < len(row):
+        if row[x] == TRANSPARENT:
+            skip += 1
+            x += 1
+            continue
+
+        start = x
+        while x < len(row) and row[x] != TRANSPARENT and x - start < MAX_RUN:
+            x += 1
+
+        # a skip longer than a byte is split into empty runs
+        while skip > MAX_RUN:
+            runs.append((MAX_RUN, 0))
+            skip -= MAX_RUN
+
+        runs.append((skip, x - start))
+        skip = 0
+    return runs
+
+
+def encode_rgb565(colours):
+    return b"".join(struct.pack(">H", colour) for colour in colours)  # big-endian, the TFT's wire format
+
+
+def encode_spans(rows, encode_pixels=encode_rgb565, prefix=b""):
+    """Encodes every row as a run count followed by (skip, length, pixels...) runs.
+    The prefix (the palette) is stored between the row table and the rows.
+    Returns the offsets of the rows relative to the start of the asset and the encoded asset."""
+    table_size = len(rows) * 4
+    row_offsets = []
+    data = bytearray(prefix)
+
+    for row in rows:
+        runs = find_runs(row)
+        if len(runs) > MAX_RUNS_PER_ROW:
+            raise ValueError(f"A row has more than {MAX_RUNS_PER_ROW} opaque runs")
+
+        row_offsets.append(table_size + len(data))
+        data += struct.pack("B", len(runs))
+
+        x = 0
+        for (skip, length) in runs:
+            x += skip
+            data += struct.pack("BB", skip, length)
+            data += encode_pixels(row[x:x + length])
+            x += length
+
+    return row_offsets, bytes(data)
+
+
+def split_fills(colours):
+    """Splits an opaque run into (fill, colours) pieces, stretches of at least FILL_MIN_RUN equal pixels are fills."""
+    pieces = []
+    start = 0
+    x = 0
+    while x < len(colours):
+        end = x
+        while end < len(colours) and colours[end] == colours[x]:
+            end += 1
+
+        if end - x >= FILL_MIN_RUN:
+            if start < x:
+                pieces.append((False, colours[start:x]))
+            pieces.append((True, colours[x:end]))
+            start = end
+        x = end
+
+    if start < len(colours):
+        pieces.append((False, colours[start:]))
+    return pieces
+
+
+def encode_fills(rows):
+    """Encodes every row as a run count followed by (skip, length, fill) runs, followed by the pixels of the run,
+    or by its single colour if fill is 1. Returns the offsets of the rows and the encoded asset, like encode_spans."""
+    table_size = len(rows) * 4
+    row_offsets = []
+    data = bytearray()
+
+    for row in rows:
+        runs = []
+        x = 0
+        for (skip, length) in find_runs(row):
+            x += skip
+            for (index, (fill, colours)) in enumerate(split_fills(row[x:x + length]) or [(False, [])]):
+                runs.append((skip if index == 0 else 0, fill, colours))
+            x += length
+
+        if len(runs) > MAX_RUNS_PER_ROW:
+            raise ValueError(f"A row has more than {MAX_RUNS_PER_ROW} runs")
+
+        row_offsets.append(table_size + len(data))
+        data += struct.pack("B", len(runs))
+
+        for (skip, fill, colours) in runs:
+            data += struct.pack("BBB", skip, len(colours), fill)
+            data += encode_rgb565(colours[:1] if fill else colours)
+
+    return row_offsets, bytes(data)
+
+
+def encode_raw(rows):
+    """Encodes a fully opaque asset as plain big-endian pixels, row after row, without a row table."""
+    return b"".join(encode_rgb565(row) for row in rows)
+
+
+def encode_palettized(rows, palette, bits):
+    """Encodes an asset as spans of palette indices, the palette (count, then big-endian RGB565 colours)
+    follows the row table. With 4 bit indices every run starts on a new byte, the first pixel in the high nibble."""
+    lookup = {colour: index for (index, colour) in enumerate(palette)}
+
+    def encode_indices(colours):
+        indices = [lookup[colour] for colour in colours]
+        if bits == 8:
+            return bytes(indices)
+
+        if len(indices) % 2:
+            indices.append(0)
+        return bytes((indices[i] << 4) | indices[i + 1] for i in range(0, len(indices), 2))
+
+    prefix = struct.pack("B", len(palette)) + encode_rgb565(palette)
+    return encode_spans(rows, encode_indices, prefix)
+
+
+def encoded_size(encoded):
+    (_, row_offsets, data) = encoded
+    return len(row_offsets) * 4 + len(data)
+
+
+def encode_asset(rows, raw=False):
+    """Picks the encoding of an asset: fully opaque assets (like the fullscreen images) are stored raw,
+    so they can be streamed from the card sector by sector. With raw set the asset is stored raw whatever it holds,
+    transparent pixels become black. Everything else is stored as spans,
+    of palette indices if the asset has few enough colours.
+    Assets with large single coloured areas are stored as fills instead if that is smaller, the renderer sends a fill
+    to the TFT without reading any pixels. Raw assets are streamed without any cost per run,
+    so an opaque asset is only stored as fills if that at least halves it."""
+    if raw:
+        return (ENCODING_RAW, [], encode_raw(rows))
+
+    fills = (ENCODING_FILL, *encode_fills(rows))
+
+    if all(colour != TRANSPARENT for row in rows for colour in row):
+        raw = (ENCODING_RAW, [], encode_raw(rows))
+        return fills if encoded_size(fills) * 2 <= encoded_size(raw) else raw
+
+    palette = sorted({colour for row in rows for colour in row if colour != TRANSPARENT})
+
+    if len(palette) <= PAL4_MAX_COLOURS:
+        encoded = (ENCODING_PAL4, *encode_palettized(rows, palette, 4))
+    elif len(palette) <= PAL8_MAX_COLOURS:
+        encoded = (ENCODING_PAL8, *encode_palettized(rows, palette, 8))
+    else:
+        encoded = (ENCODING_SPANS, *encode_spans(rows))
+
+    return fills if encoded_size(fills) < encoded_size(encoded) else encoded
+
+
+def write_pack(path: Path, assets):
+    if len(assets) > 255:
+        raise ValueError("An asset pack holds at most 255 assets")
+
+    header_size = len(MAGIC) + 1 + len(assets) * ENTRY_SIZE
+    index = bytearray()
+    blob = bytearray()
+
+    for (name, width, height, (encoding, row_offsets, data)) in assets:
+        encoded_name = name.encode("ascii")
+        if len(encoded_name) >= NAME_LEN:
+            raise ValueError(f"Asset name '{name}' must be shorter than {NAME_LEN} characters")
+
+        # raw assets start on a sector boundary, so streaming them never splits a pixel between two sectors
+        if encoding == ENCODING_RAW:
+            blob += b"\0" * (-(header_size + len(blob)) % SECTOR_SIZE)
+
+        base = header_size + len(blob)
+        index += encoded_name.ljust(NAME_LEN, b"\0")
+        index += struct.pack("<HHIB", width, height, base, encoding)
+
+        # row table with absolute offsets, so a clipped draw can start at any row
+        for offset in row_offsets:
+            blob += struct.pack("<I", base + offset)
+        blob += data
+
+    with open(path, "wb") as f:
+        f.write(MAGIC)                          # 5 bytes
+        f.write(struct.pack("B", len(assets)))  # 1 byte
+        f.write(index)                          # 13 bytes per asset
+        f.write(blob)
+
+    print(f"✓ Packed {len(assets)} assets ({len(blob)} bytes of pixel data) into {path}")
+
+
+def parse_input(arg: str):
+    """Accepts either NAME=path.bmp[,frame.bmp ...] or a plain path, in which case the file stem is the asset name."""
+    if "=" in arg:
+        name, paths = arg.split("=", 1)
+        return name, [Path(path) for path in paths.split(",")]
+
+    path = Path(arg)
+    return path.stem, [path]
+
+
+def sheet_frame(path: Path):
+    """NAME.3.bmp (or NAME.3) is frame 3 of sheet NAME, returns (NAME, 3), or None for a plain asset."""
+    parts = path.name.split(".")
+    if len(parts) < 2 or not parts[1].isdigit():
+        return None
+    return parts[0], int(parts[1])
+
+
+def collect_inputs(args):
+    """Returns (name, paths) per asset, a sheet has a path per frame."""
+    inputs = []
+    for arg in args:
+        name, paths = parse_input(arg)
+
+        if len(paths) == 1 and paths[0].is_dir():
+            sheets = {}
+            for child in sorted(paths[0].iterdir()):
+                if not child.is_file() or child.read_bytes()[0:2] != b"BM":
+                    continue
+
+                frame = sheet_frame(child)
+                if frame is None:
+                    inputs.append((child.stem, [child]))
+                else:
+                    sheets.setdefault(frame[0], []).append((frame[1], child))
+
+            for sheet, frames in sorted(sheets.items()):
+                inputs.append((sheet, [path for (_, path) in sorted(frames)]))
+        else:
+            inputs.append((name, paths))
+    return inputs
+
+
+def main():
+    if len(sys.argv) < 3:
+        print("Usage:")
+        print("  python asset_packer.py output.gpk NAME=input.bmp [NAME=input.bmp ...]")
+        print("  python asset_packer.py output.gpk NAME=frame0.bmp,frame1.bmp,...")
+        print("  python asset_packer.py output.gpk sdcard_directory/")
+        print()
+        print("Asset names are the resource names from src/resources.h (e.g. A for the water tile).")
+        print("A list of frames (or NAME.0.bmp, NAME.1.bmp, ... in a directory) is packed as a sprite sheet.")
+        print("--raw=NAME[,NAME ...] stores those assets raw with black as a colour, like the fullscreen images "
+              f"({', '.join(sorted(RAW_ASSETS))}) always are.")
+        print("Copy the output to the SD card as the file named by GFX_CONFIG_ASSET_PACK.")
+        sys.exit(1)
+
+    out_path = Path(sys.argv[1])
+
+    args = []
+    raw_assets = set(RAW_ASSETS)
+    for arg in sys.argv[2:]:
+        if arg.startswith("--raw="):
+            raw_assets.update(arg[len("--raw="):].split(","))
+        else:
+            args.append(arg)
+
+    assets = []
+    for (name, paths) in collect_inputs(args):
+        width, height, rows = load_sheet(paths)
+        assets.append((name, width, height, encode_asset(convert_rows(rows), name in raw_assets)))
+
+    write_pack(out_path, assets)
+
+
+if __name__ == "__main__":
+    main()
@@ -50,6 +50,22 @@ def load_notes_from_csv(path: Path):
     return looping, notes
 
 
+def load_notes_from_sfd(path: Path):
+    data = path.read_bytes()
+
+    if data[:len(MAGIC)] != MAGIC:
+        raise ValueError(f"{path} is not an sfd file")
+
+    looping, count = struct.unpack_from("<BI", data, len(MAGIC))
+    start = len(MAGIC) + 5
+
+    if len(data) < start + count * 4:
+        raise ValueError(f"{path} holds fewer notes than its header says")
+
+    notes = [struct.unpack_from("<HH", data, start + i * 4) for i in range(count)]
+    return looping != 0, notes
+
+
 def write_sfd(path: Path, looping: bool, notes):
     with open(path, "wb") as f:
         # Header
@@ -71,7 +87,10 @@ def guess_input_file(path: Path):
     if path.suffix.lower() == ".csv":
         return load_notes_from_csv(path)
 
-    raise ValueError("Unsupported file type. Use JSON or CSV.")
+    if path.suffix.lower() == ".sfd":
+        return load_notes_from_sfd(path)
+
+    raise ValueError("Unsupported file type. Use JSON, CSV or SFD.")
 
 
 def main():
@@ -0,0 +1,75 @@
+#!/usr/bin/env python3
+"""Compiles the sound tracks into flash: writes src/sound/tracks.c with every track as a PROGMEM array in the sfd
+format (see src/sound/sound.h), so play_sound plays them without touching the SD card.
+
+Runs before every build as a PlatformIO extra script, or by hand:
+  python sound_tracks.py
+"""
+import struct
+import sys
+from pathlib import Path
+
+try:
+    Import("env")  # noqa: F821, defined when PlatformIO runs this as an extra script
+    PROJECT_DIR = Path(env.subst("$PROJECT_DIR"))  # noqa: F821
+except NameError:
+    PROJECT_DIR = Path(sys.argv[0]).resolve().parent.parent
+
+sys.path.insert(0, str(PROJECT_DIR / "misc"))
+from sfd_generator import MAGIC, guess_input_file  # noqa: E402
+
+# resource name (src/resources.h) -> track in misc/, keep these in sync
+TRACKS = {
+    "Y": "hop.json",     # HOP
+    "Z": "tetris.json",  # TETRIS
+    "X": "zelda.sfd",    # ZELDA, only kept as an sfd file
+}
+
+OUTPUT = PROJECT_DIR / "src" / "sound" / "tracks.c"
+
+
+def encode_sfd(looping: bool, notes):
+    """Encodes a track exactly like write_sfd stores it on the SD card."""
+    data = bytearray(MAGIC)
+    data += struct.pack("B", 1 if looping else 0)
+    data += struct.pack("<I", len(notes))
+    for (freq, dur) in notes:
+        data += struct.pack("<HH", freq, dur)
+    return bytes(data)
+
+
+def generate():
+    lines = [
+        "// Generated by misc/sound_tracks.py from the tracks in misc/, do not edit",
+        "",
+        "#include <avr/pgmspace.h>",
+        '#include "tracks.h"',
+        "",
+    ]
+
+    for (name, source) in TRACKS.items():
+        data = encode_sfd(*guess_input_file(PROJECT_DIR / "misc" / source))
+        lines.append(f"// {source}")
+        lines.append(f"static const uint8_t track_{name}[] PROGMEM = {{")
+        for i in range(0, len(data), 16):
+            lines.append("    " + ", ".join(f"0x{byte:02X}" for byte in data[i:i + 16]) + ",")
+        lines.append("};")
+        lines.append("")
+
+    lines.append("const s_FlashTrack flash_tracks[] = {")
+    for name in TRACKS:
+        lines.append(f'    {{ "{name}", track_{name} }},')
+    lines.append("};")
+    lines.append("")
+    lines.append(f"const uint8_t flash_track_count = {len(TRACKS)};")
+    lines.append("")
+
+    text = "\n".join(lines)
+
+    # only written when a track changed, so the build doesn't recompile it every time
+    if not OUTPUT.exists() or OUTPUT.read_text() != text:
+        OUTPUT.write_text(text)
+        print(f"✓ Compiled {len(TRACKS)} sound tracks into {OUTPUT}")
+
+
+generate()
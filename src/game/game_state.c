@@ -34,6 +34,9 @@ void show_fullscreen(const char* filename) {
         .bitmap = &start_game_bitmap,
     };
 
+    // a level that is still scrolling in would shift the screen
+    gfx_scroll_stop();
+
     gfx_init_bitmap(&start_game_bitmap);
     gfx_draw_sprite(&start_game_sprite);
 }
@@ -61,8 +64,8 @@ void game_over(uint16_t score) {
     proto_emit(CMD_GAME_OVER, data);
 
     show_fullscreen(GAMEOVER_SCREEN);
-    gravur_write_integer(142, 123, 2, false, score);
-    gravur_write_integer(142, 139, 2, false, high_score);
+    gravur_write_integer(142, 123, 2, false, false, score);
+    gravur_write_integer(142, 139, 2, false, false, high_score);
 }
 
 enum Game_State get_game_state() {
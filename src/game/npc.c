@@ -5,11 +5,25 @@
 #include <gfx/gfx.h>
 #include "npc.h"
 
+// an npc that stands still this long starts to look around
+#define NPC_IDLE_MS 1500
+
+// frame of PLAYER_SHEET for every heading
+static const uint8_t heading_frames[DIR_COUNT] = {
+    1, // NORTH: PLAYER_BOTTOM_RIGHT
+    2, // EAST: PLAYER_TOP_LEFT
+    3, // SOUTH: PLAYER_TOP_RIGHT
+    0, // WEST: PLAYER_BOTTOM_LEFT
+};
+
+// turns clockwise: north, east, south, west
+static const uint8_t idle_frames[] = { 1, 2, 3, 0 };
+static const gfx_animation_t idle_animation = { idle_frames, sizeof(idle_frames), 500, true };
+
 void init_npc(game_npc_t* npc) {
-    gfx_init_bitmap(&(npc->tex_north));
-    gfx_init_bitmap(&(npc->tex_east));
-    gfx_init_bitmap(&(npc->tex_south));
-    gfx_init_bitmap(&(npc->tex_west));
+    gfx_init_bitmap(&(npc->sheet));
+    npc->sprite.bitmap = &(npc->sheet);
+    npc->idle.sprite = &(npc->sprite);
     move_npc(npc, NORTH, 500, 500);
 }
 
@@ -17,11 +31,23 @@ void move_npc(game_npc_t *npc, e_DIRECTION heading, int16_t x, int16_t y) {
     gfx_sprite_t* sprite = &(npc->sprite);
     gfx_move_sprite(sprite, x, y);
 
-    switch (heading) {
-        case NORTH: gfx_set_bitmap_sprite(sprite, &(npc->tex_north)); break;
-        case EAST: gfx_set_bitmap_sprite(sprite, &(npc->tex_east)); break;
-        case SOUTH: gfx_set_bitmap_sprite(sprite, &(npc->tex_south)); break;
-        case WEST: gfx_set_bitmap_sprite(sprite, &(npc->tex_west)); break;
-        default: break;
+    if (npc->idling) {
+        gfx_anim_stop(&(npc->idle));
+        npc->idling = false;
+    }
+    npc->moved = true;
+
+    // turning only changes the frame of the sheet, which is read from the open pack
+    if (heading < DIR_COUNT) {
+        gfx_set_frame_sprite(sprite, heading_frames[heading]);
     }
-}
\ No newline at end of file
+}
+
+void update_npc(game_npc_t *npc, uint32_t now) {
+    if (npc->moved) {
+        npc->moved = false;
+        npc->still_since = now;
+    } else if (!npc->idling && now - npc->still_since >= NPC_IDLE_MS) {
+        npc->idling = gfx_anim_play(&(npc->idle), &idle_animation, now);
+    }
+}
@@ -6,17 +6,22 @@
 #define ATMEGA_GAME_NPC_H
 
 #include "gfx/gfx.h"
+#include "gfx/anim.h"
 #include "game/player.h"
 
 typedef struct game_npc {
-    gfx_bitmap_t  tex_north;
-    gfx_bitmap_t  tex_east;
-    gfx_bitmap_t  tex_south;
-    gfx_bitmap_t  tex_west;
+    gfx_bitmap_t  sheet; // a frame per direction, see PLAYER_SHEET
     gfx_sprite_t  sprite;
+    gfx_anim_player_t idle; // looks around while the npc stands still
+    uint32_t still_since;   // time the npc stopped moving
+    bool moved;             // moved since the last update_npc
+    bool idling;            // the idle animation is playing
 } game_npc_t;
 
 void init_npc(game_npc_t* npc);
 void move_npc(game_npc_t *npc, e_DIRECTION heading, int16_t x, int16_t y);
 
+// Starts the idle animation once the npc stood still for a while, call before gfx_anim_tick
+void update_npc(game_npc_t *npc, uint32_t now);
+
 #endif //ATMEGA_GAME_NPC_H
\ No newline at end of file
@@ -139,7 +139,7 @@ void move_player(uint8_t x_stick_val, uint8_t y_stick_val)
     }
 
     if (current_game_type == RUNNER) {
-        // play_sound(HOP, 0);
+        play_sound_effect(HOP, SFX_PRIORITY_LOW);
     }
 
     gfx_vec2_t last_position = playerPosition;
@@ -163,14 +163,17 @@ void move_player(uint8_t x_stick_val, uint8_t y_stick_val)
         playerPosition.x = GFX_TILEMAP_WIDTH - 1;
     }
 
-    if (playerPosition.y < 0) {
-        playerPosition.y = 0;
+    // Stay within the rows in view
+    const int16_t view_top = world_get_tilemap()->top;
+
+    if (playerPosition.y < view_top) {
+        playerPosition.y = view_top;
     }
-    else if (playerPosition.y > GFX_TILEMAP_HEIGHT - 1) {
-        playerPosition.y = GFX_TILEMAP_HEIGHT - 1;
+    else if (playerPosition.y > view_top + GFX_TILEMAP_HEIGHT - 1) {
+        playerPosition.y = view_top + GFX_TILEMAP_HEIGHT - 1;
     }
 
-    uint16_t tilemap_index = (playerPosition.y) * GFX_TILEMAP_WIDTH + playerPosition.x;
+    uint16_t tilemap_index = WORLD_TILE_INDEX(playerPosition.x, playerPosition.y);
     if ((tile_flags[tilemap_index] & TILE_INACCESSIBLE_FLAG) > 0 && current_game_type == RUNNER) {
         playerPosition = last_position;
     }
@@ -188,8 +191,12 @@ void move_player(uint8_t x_stick_val, uint8_t y_stick_val)
         add_score();
     }
 
-    gfx_vec2_t player_screen_pos = gfx_world_to_screen(playerPosition);
-    gfx_move_sprite(&player, player_screen_pos.x, player_screen_pos.y);
+    // the view follows the runner down the world
+    if (current_game_type == RUNNER) {
+        world_follow(playerPosition.y);
+    }
+
+    player_update_sprite();
 
     uint8_t data[4] = { dir, (uint8_t)(playerPosition.x), (uint8_t)(playerPosition.y), 0 };
     proto_emit(CMD_MOVE, data);
@@ -199,7 +206,7 @@ void move_player(uint8_t x_stick_val, uint8_t y_stick_val)
 void update_game_state() {
     // Death can't die
     if (current_game_type == RUNNER) {
-        uint16_t tilemap_index = (playerPosition.y) * GFX_TILEMAP_WIDTH + playerPosition.x;
+        uint16_t tilemap_index = WORLD_TILE_INDEX(playerPosition.x, playerPosition.y);
         if ((tile_flags[tilemap_index] & TILE_DEADLY_FLAG) > 0) {
             game_over(score);
         }
@@ -210,12 +217,12 @@ void update_game_state() {
 }
 
 void mark_tile_trap(gfx_vec2_t world_pos) {
-    uint8_t idx = world_pos.y * GFX_TILEMAP_WIDTH + world_pos.x;
+    uint8_t idx = WORLD_TILE_INDEX(world_pos.x, world_pos.y);
     tile_flags[idx] |= TILE_DEADLY_FLAG;
 }
 
 void unmark_tile_trap(gfx_vec2_t world_pos) {
-    uint8_t idx = world_pos.y * GFX_TILEMAP_WIDTH + world_pos.x;
+    uint8_t idx = WORLD_TILE_INDEX(world_pos.x, world_pos.y);
     tile_flags[idx] &= ~TILE_DEADLY_FLAG;
 }
 
@@ -260,6 +267,10 @@ void player_reset_position() {
     playerPosition.y = 0;
     maxY = 0;
 
+    player_update_sprite();
+}
+
+void player_update_sprite() {
     gfx_vec2_t player_screen_pos = gfx_world_to_screen(playerPosition);
     gfx_move_sprite(&player, player_screen_pos.x, player_screen_pos.y);
 }
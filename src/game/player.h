@@ -34,6 +34,9 @@ e_GAME_TYPE player_get_role();
 
 void player_reset_position();
 
+// Places the sprite at the player's world position again, needed after the view moved
+void player_update_sprite();
+
 void reset_playtime();
 
 uint16_t player_get_score();
@@ -0,0 +1,71 @@
+#include "anim.h"
+
+static gfx_anim_player_t *players[GFX_ANIM_MAX_PLAYERS];
+static uint8_t player_count;
+
+void gfx_anim_reset() {
+    player_count = 0;
+}
+
+bool gfx_anim_play(gfx_anim_player_t *player, const gfx_animation_t *animation, const uint32_t now) {
+    if (animation->frame_count == 0) {
+        return false;
+    }
+
+    bool playing = false;
+    for (uint8_t i = 0; i < player_count; i++) {
+        playing = playing || players[i] == player;
+    }
+
+    if (!playing) {
+        if (player_count >= GFX_ANIM_MAX_PLAYERS) {
+            return false;
+        }
+        players[player_count++] = player;
+    }
+
+    player->animation = animation;
+    player->index = 0;
+    player->due_ms = now + animation->frame_ms;
+    gfx_set_frame_sprite(player->sprite, animation->frames[0]);
+    return true;
+}
+
+void gfx_anim_stop(gfx_anim_player_t *player) {
+    for (uint8_t i = 0; i < player_count; i++) {
+        if (players[i] == player) {
+            players[i] = players[--player_count];
+            return;
+        }
+    }
+}
+
+bool gfx_anim_finished(const gfx_anim_player_t *player) {
+    return !player->animation->looping && player->index == player->animation->frame_count - 1;
+}
+
+void gfx_anim_tick(const uint32_t now) {
+    for (uint8_t i = 0; i < player_count; i++) {
+        gfx_anim_player_t *player = players[i];
+        const gfx_animation_t *animation = player->animation;
+
+        // the difference wraps along with the timer
+        if (gfx_anim_finished(player) || (int32_t)(now - player->due_ms) < 0) {
+            continue;
+        }
+
+        // frames that were due during a slow frame are skipped, only the current one is drawn
+        const uint32_t steps = 1 + (animation->frame_ms > 0 ? (now - player->due_ms) / animation->frame_ms : 0);
+        const uint32_t index = player->index + steps;
+
+        if (animation->looping) {
+            player->index = (uint8_t)(index % animation->frame_count);
+        } else {
+            const uint32_t frame_count = animation->frame_count;
+            player->index = (uint8_t)(index < frame_count ? index : frame_count - 1);
+        }
+
+        player->due_ms += steps * animation->frame_ms;
+        gfx_set_frame_sprite(player->sprite, animation->frames[player->index]);
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef ATMEGA_GAME_ANIM_H
+#define ATMEGA_GAME_ANIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "gfx.h"
+
+#ifndef GFX_ANIM_MAX_PLAYERS
+#define GFX_ANIM_MAX_PLAYERS 4
+#endif // GFX_ANIM_MAX_PLAYERS
+
+// A sequence of frames of a sprite sheet
+typedef struct gfx_animation
+{
+    const uint8_t *frames; // frames of the sheet, in the order they are shown
+    uint8_t frame_count;
+    uint16_t frame_ms;     // how long every frame is shown
+    bool looping;          // starts over after the last frame, otherwise the last frame stays
+} gfx_animation_t;
+
+/*
+Playback state of an animated sprite.
+Frames advance on time (not per rendered frame), so a slow frame skips animation frames instead of slowing them down.
+A sprite is only invalidated when its frame actually changes.
+*/
+typedef struct gfx_anim_player
+{
+    gfx_sprite_t *sprite;
+    const gfx_animation_t *animation;
+    uint8_t index;    // position in the frames of the animation
+    uint32_t due_ms;  // time at which the next frame is shown
+} gfx_anim_player_t;
+
+// Stops all animations, the sprites keep their current frame
+GFX_EXTERN_C void gfx_anim_reset();
+
+// Plays an animation on the player's sprite from its first frame, the player must stay alive until it is stopped
+GFX_EXTERN_C bool gfx_anim_play(gfx_anim_player_t *player, const gfx_animation_t *animation, uint32_t now);
+
+// Stops an animation, the sprite keeps its current frame
+GFX_EXTERN_C void gfx_anim_stop(gfx_anim_player_t *player);
+
+// Whether a non-looping animation has reached its last frame
+GFX_EXTERN_C bool gfx_anim_finished(const gfx_anim_player_t *player);
+
+// Advances every playing animation to the given time (scheduler_millis), call before gfx_frame
+GFX_EXTERN_C void gfx_anim_tick(uint32_t now);
+
+#endif //ATMEGA_GAME_ANIM_H
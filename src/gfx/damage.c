@@ -0,0 +1,124 @@
+#include "damage.h"
+
+static gfx_rect_t damage[GFX_TILEMAP_MAX_DIRTY_PER_FRAME];
+static uint8_t damage_count = 0;
+static gfx_damage_stats_t stats;
+static gfx_damage_stats_t last_stats;
+
+static uint32_t rect_area(const gfx_rect_t *rect) {
+    return (uint32_t)rect->width * rect->height;
+}
+
+static gfx_rect_t rect_union(const gfx_rect_t *a, const gfx_rect_t *b) {
+    const int16_t x0 = a->x < b->x ? a->x : b->x;
+    const int16_t y0 = a->y < b->y ? a->y : b->y;
+    const int16_t x1 = (a->x + a->width) > (b->x + b->width) ? (a->x + a->width) : (b->x + b->width);
+    const int16_t y1 = (a->y + a->height) > (b->y + b->height) ? (a->y + a->height) : (b->y + b->height);
+
+    return (gfx_rect_t){ x0, y0, x1 - x0, y1 - y0 };
+}
+
+static bool rect_overlaps(const gfx_rect_t *a, const gfx_rect_t *b) {
+    return a->x < b->x + b->width && b->x < a->x + a->width &&
+           a->y < b->y + b->height && b->y < a->y + a->height;
+}
+
+// clips a rect against the screen, returns false if nothing is left
+static bool rect_clip(gfx_rect_t *rect) {
+    const gfx_rect_t screen = GFX_FULLSCREEN;
+
+    int16_t x0 = rect->x < screen.x ? screen.x : rect->x;
+    int16_t y0 = rect->y < screen.y ? screen.y : rect->y;
+    int16_t x1 = rect->x + rect->width;
+    int16_t y1 = rect->y + rect->height;
+    x1 = x1 > screen.x + screen.width ? screen.x + screen.width : x1;
+    y1 = y1 > screen.y + screen.height ? screen.y + screen.height : y1;
+
+    if (x0 >= x1 || y0 >= y1) {
+        return false;
+    }
+
+    *rect = (gfx_rect_t){ x0, y0, x1 - x0, y1 - y0 };
+    return true;
+}
+
+void gfx_damage_reset() {
+    damage_count = 0;
+    stats = (gfx_damage_stats_t){ 0 };
+}
+
+void gfx_damage_push(gfx_rect_t rect) {
+    if (!rect_clip(&rect)) {
+        return;
+    }
+
+    stats.pushed++;
+    stats.pushed_area += rect_area(&rect);
+
+    if (stats.overflowed) {
+        return;
+    }
+
+    // merge with existing damage for as long as that is cheaper, the merged rect may now reach other rects
+    for (uint8_t i = 0; i < damage_count; i++) {
+        const gfx_rect_t merged = rect_union(&rect, &damage[i]);
+
+        if (rect_area(&merged) > rect_area(&rect) + rect_area(&damage[i]) + GFX_DAMAGE_RECT_COST) {
+            continue;
+        }
+
+        rect = merged;
+        damage[i] = damage[--damage_count];
+        i = 0xFF; // restart, wraps to 0
+    }
+
+    if (damage_count >= GFX_TILEMAP_MAX_DIRTY_PER_FRAME) {
+        stats.overflowed = true;
+        return;
+    }
+
+    damage[damage_count++] = rect;
+}
+
+bool gfx_damage_overflowed() {
+    return stats.overflowed;
+}
+
+uint8_t gfx_damage_count() {
+    return stats.overflowed ? 0 : damage_count;
+}
+
+const gfx_rect_t *gfx_damage_get(const uint8_t index) {
+    return &damage[index];
+}
+
+bool gfx_damage_overlaps(const gfx_rect_t *rect) {
+    for (uint8_t i = 0; i < gfx_damage_count(); i++) {
+        if (rect_overlaps(rect, &damage[i])) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void gfx_damage_end_frame() {
+    if (stats.overflowed) {
+        const gfx_rect_t screen = GFX_FULLSCREEN;
+        stats.drawn = 0;
+        stats.drawn_area = rect_area(&screen);
+    } else {
+        stats.drawn = damage_count;
+        stats.drawn_area = 0;
+        for (uint8_t i = 0; i < damage_count; i++) {
+            stats.drawn_area += rect_area(&damage[i]);
+        }
+    }
+
+    last_stats = stats;
+    gfx_damage_reset();
+}
+
+gfx_damage_stats_t gfx_damage_get_stats() {
+    return last_stats;
+}
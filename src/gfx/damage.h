@@ -0,0 +1,49 @@
+#ifndef ATMEGA_GAME_DAMAGE_H
+#define ATMEGA_GAME_DAMAGE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "gfx.h"
+
+// Fixed cost of drawing a rect (tile lookups, SD seeks, address windows) expressed in pixels.
+// Two rects are merged into their bounding box when the box is at most this much larger than both rects together.
+#ifndef GFX_DAMAGE_RECT_COST
+#define GFX_DAMAGE_RECT_COST 256
+#endif // GFX_DAMAGE_RECT_COST
+
+// Overdraw statistics of a single frame
+typedef struct gfx_damage_stats
+{
+    uint8_t pushed;       // rects pushed
+    uint8_t drawn;        // rects left after merging
+    uint32_t pushed_area; // pixels pushed, overlapping pixels are counted for every rect
+    uint32_t drawn_area;  // pixels covered by the merged rects
+    bool overflowed;      // rects did not fit, the whole tilemap was redrawn
+} gfx_damage_stats_t;
+
+// Clears all damage and the statistics of the current frame
+GFX_EXTERN_C void gfx_damage_reset();
+
+// Adds a damaged screen area, merging it with the existing damage where that is cheaper
+GFX_EXTERN_C void gfx_damage_push(gfx_rect_t rect);
+
+// Whether the damage did not fit and the whole screen has to be redrawn
+GFX_EXTERN_C bool gfx_damage_overflowed();
+
+// Amount of damaged rects
+GFX_EXTERN_C uint8_t gfx_damage_count();
+
+// Gets a damaged rect
+GFX_EXTERN_C const gfx_rect_t *gfx_damage_get(uint8_t index);
+
+// Whether a rect overlaps any of the damage
+GFX_EXTERN_C bool gfx_damage_overlaps(const gfx_rect_t *rect);
+
+// Stores the statistics of the finished frame and clears all damage
+GFX_EXTERN_C void gfx_damage_end_frame();
+
+// Gets the statistics of the last finished frame
+GFX_EXTERN_C gfx_damage_stats_t gfx_damage_get_stats();
+
+#endif //ATMEGA_GAME_DAMAGE_H
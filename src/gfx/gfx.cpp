@@ -5,142 +5,958 @@
 #define SDCARD_CS_PIN 4
 #define ILI9341_CS_PIN 10 // <= /CS pin (chip-select, LOW to get attention of ILI9341, HIGH and it ignores SPI bus)
 #define ILI9341_DC_PIN 9  // <= DC pin (1=data or 0=command indicator line) also called RS
-#define PIXELS_PER_READ 16
+#define PIXELS_PER_READ 32
 
 #include <gfx/gfx.h>
+#include <gfx/damage.h>
+#include <gfx/iso.h>
+#include <gfx/hud.h>
+#include <gfx/anim.h>
 #include <util/delay.h>
 #include <SdFat_Adafruit_Fork.h>
 #include <Adafruit_GFX.h>
 #include <Adafruit_ILI9341.h>
 #include <stdbool.h>
+#include <string.h>
+
+#ifdef GFX_CONFIG_BENCHMARK
+#include <stdio.h>
+#include "hardware/uart/uart.h"
+#include "../../lib/scheduler/delay.h"
+#endif // GFX_CONFIG_BENCHMARK
+
+#define ILI9341_WRITE_MEMORY_CONTINUE 0x3C
+
+// A palette in the palette cache
+typedef struct gfx_palette_slot {
+    int32_t offset; // offset of the bitmap the palette belongs to, unique within the pack
+    uint8_t start;  // first colour in the palette pool
+    uint8_t count;  // colours
+} gfx_palette_slot_t;
+
+// A bitmap that covers the cell being composited
+typedef struct gfx_drawable {
+    const gfx_bitmap_t *bitmap;
+    int16_t x;
+    int16_t y;
+    int16_t top;    // first row of the bitmap that is shown (the frame of a sprite sheet)
+    int16_t height; // rows shown
+} gfx_drawable_t;
+
+// What the damage compositor may still do in a frame
+typedef struct gfx_budget {
+    int32_t pixels;
+    int16_t reads; // drawables read from the card, a drawable is read once per cell
+} gfx_budget_t;
 
 gfx_scene_t *active_scene;
-gfx_rect_t dirty_rects[GFX_TILEMAP_MAX_DIRTY_PER_FRAME];
-uint8_t dirty_rects_count = 0;
+// The cell being composited, lines of big-endian RGB565 pixels GFX_COMPOSITOR_CELL_WIDTH pixels apart
+static uint8_t cell_buffer[GFX_COMPOSITOR_CELL_WIDTH * GFX_COMPOSITOR_CELL_HEIGHT * 2];
+
+// View positions whose tiles are drawn straight to the screen in the next frame, a bit per position (tx + ty * width)
+static uint8_t stale_tiles[(GFX_TILEMAP_WIDTH * GFX_TILEMAP_HEIGHT + 7) / 8];
+
+// Lines of the scroll area the running scrolling transition has brought in, GFX_SCROLL_AREA when there is none
+static int16_t scroll_progress = GFX_SCROLL_AREA;
 SdFat32 SD;
 
+// The asset pack stays open between draws, so a draw never walks the FAT directory
+static File32 pack;
+// Bumped whenever the pack is opened, bitmaps looked up in an older pack are looked up again
+static uint8_t pack_generation;
+// Sector range of the pack on the card, both 0 if the pack is fragmented
+static uint32_t pack_first_sector;
+static uint32_t pack_last_sector;
+static gfx_pack_stats_t pack_stats;
+
+// Palettes of the most recently drawn palettized bitmaps, big-endian RGB565 like the pixels on the TFT
+static uint8_t palette_pool[GFX_PALETTE_CACHE_COLOURS * 2];
+// least recently used first
+static gfx_palette_slot_t palette_slots[GFX_PALETTE_CACHE_SLOTS];
+static uint8_t palette_slot_count;
+static uint8_t palette_pool_used; // colours
+
 Adafruit_ILI9341 tft = Adafruit_ILI9341(ILI9341_CS_PIN, ILI9341_DC_PIN);
 
+/*
+Writes a run of big-endian RGB565 pixels to the current address window, must be called within a batch.
+On AVR the bytes are already in wire order, so they are clocked out directly, loading the next byte while the
+previous one is still shifting out. Other platforms hand the run to writePixels in one go.
+*/
+static void gfx_write_span(const uint8_t *pixels, uint16_t count) {
+#if defined(__AVR__)
+    uint16_t bytes = count * 2;
+    if (bytes == 0) {
+        return;
+    }
+
+    SPDR = *pixels++;
+    while (--bytes) {
+        const uint8_t next = *pixels++;
+        while (!(SPSR & _BV(SPIF)));
+        SPDR = next;
+    }
+    while (!(SPSR & _BV(SPIF)));
+#else
+    tft.writePixels((uint16_t *)pixels, count, true, true);
+#endif
+}
+
 void gfx_init() {
-    if(!SD.begin(SDCARD_CS_PIN, SD_SCK_MHZ(25))) {
+    if(!gfx_remount()) {
         for(;;);
     }
 
     tft.begin();
+    tft.setScrollMargins(GFX_SCROLL_TOP_FIXED, 0);
+    tft.scrollTo(GFX_SCROLL_TOP_FIXED);
 
     _delay_ms(200);
     gfx_reset();
 }
 
+bool gfx_remount() {
+    // the card may have been swapped, so the open pack and every looked up bitmap are stale
+    pack.close();
+    return SD.begin(SDCARD_CS_PIN, SD_SCK_MHZ(25));
+}
+
+// Opens the asset pack if it is not open yet, returns NULL if it can't be opened
+static File32 *gfx_pack() {
+    if (pack.isOpen()) {
+        return &pack;
+    }
+
+    if (!pack.open(GFX_CONFIG_ASSET_PACK)) {
+        return NULL;
+    }
+
+    if (!pack.contiguousRange(&pack_first_sector, &pack_last_sector)) {
+        pack_first_sector = 0;
+        pack_last_sector = 0;
+    }
+
+    // generation 0 is reserved for bitmaps that were never looked up
+    if (++pack_generation == 0) {
+        pack_generation = 1;
+    }
+
+    // palettes are cached by offset, which is only unique within a single pack
+    palette_slot_count = 0;
+    palette_pool_used = 0;
+
+    pack_stats.opens++;
+    return &pack;
+}
+
 /*
-refer to: https://en.wikipedia.org/wiki/BMP_file_format
-
-Offset (bytes) 	Size (bytes) 	OS/2 1.x BITMAPCOREHEADER[3]
-10 	4 	The offset, i.e. starting address, of the byte where the bitmap image data (pixel array) can be found.
-14 	4 	The size of this header (12 bytes)
-18 	2 	The bitmap width in pixels (unsigned 16-bit)
-20 	2 	The bitmap height in pixels (unsigned 16-bit)
-22 	2 	The number of color planes, must be 1
-24 	2 	The number of bits per pixel
-
-Please note that we always assume the format to be BGR24, which is the native format of the TFT display.
-The relevant ffmpeg command for conversion is: ``ffmpeg -i INPUT.PNG -pix_fmt bgr24 OUTPUT.BMP``
+Looks the bitmap up in the index of the asset pack, see gfx.h for the layout.
+The pack is made from the BMPs with ``misc/asset_packer.py``, which already converts every pixel to big-endian RGB565
+and splits every row into opaque runs (or stores it raw if it is fully opaque),
+so drawing is a plain copy from the SD card to the TFT.
 */
+static int gfx_lookup_bitmap(File32 &f, gfx_bitmap_t *bitmap) {
+    uint8_t h[GFX_ASSET_MAGIC_LEN + 1];
+    f.seek(0);
+    if (f.read(h, sizeof(h)) != sizeof(h) || memcmp(h, GFX_ASSET_MAGIC, GFX_ASSET_MAGIC_LEN) != 0) {
+        return -1;
+    }
+
+    const uint8_t count = h[GFX_ASSET_MAGIC_LEN];
+
+    for (uint8_t i = 0; i < count; i++) {
+        uint8_t entry[GFX_ASSET_ENTRY_SIZE];
+        if (f.read(entry, sizeof(entry)) != sizeof(entry)) {
+            break;
+        }
+
+        if (strncmp((const char *)entry, bitmap->filename, GFX_ASSET_NAME_LEN) != 0) {
+            continue;
+        }
+
+        bitmap->width = *(uint16_t *)(entry + GFX_ASSET_NAME_LEN);
+        bitmap->height = *(uint16_t *)(entry + GFX_ASSET_NAME_LEN + 2);
+        bitmap->offset = *(uint32_t *)(entry + GFX_ASSET_NAME_LEN + 4);
+        bitmap->encoding = entry[GFX_ASSET_NAME_LEN + 8];
+        bitmap->generation = pack_generation;
+        return 0;
+    }
+
+    // asset is not in the pack
+    return -1;
+}
+
+// Gets the open pack for drawing a bitmap, looking the bitmap up again if it belongs to an older pack
+static File32 *gfx_pack_bitmap(gfx_bitmap_t *bitmap) {
+    File32 *f = gfx_pack();
+    if (f == NULL) {
+        return NULL;
+    }
+
+    if (bitmap->generation == pack_generation) {
+        pack_stats.hits++;
+        return f;
+    }
+
+    pack_stats.misses++;
+    return gfx_lookup_bitmap(*f, bitmap) == 0 ? f : NULL;
+}
+
 int gfx_init_bitmap(gfx_bitmap_t* bitmap) {
-    File32 f = SD.open(bitmap->filename);
-    if (!f) {
+    File32 *f = gfx_pack();
+    if (f == NULL) {
         return SD.sdErrorCode();
     }
 
-    uint8_t h[54];
-    f.read(h, 54);
-    bitmap->offset = *(uint32_t *)(h + 10);
-    int32_t width = *(int32_t *)(h + 18);
-    bitmap->row_size = ((width * 3) + 3) & ~3;
-    f.close();
-    return 0;
+    return gfx_lookup_bitmap(*f, bitmap);
 }
 
-void gfx_frame() {
-    // exit if no scene is defined
+gfx_pack_stats_t gfx_get_pack_stats() {
+    return pack_stats;
+}
+
+// Gets the range of tiles that may cover a screen area
+static void gfx_tiles_in_rect(const gfx_rect_t *rect, gfx_vec2_t *tile_min, gfx_vec2_t *tile_max) {
+    // bottom-right corner
+    int16_t x1 = rect->x + rect->width - 1;
+    int16_t y1 = rect->y + rect->height - 1;
+
+    // get the world position of *all* four corners.
+    gfx_vec2_t c0 = gfx_iso_screen_to_world(rect->x, rect->y);
+    gfx_vec2_t c1 = gfx_iso_screen_to_world(x1, rect->y);
+    gfx_vec2_t c2 = gfx_iso_screen_to_world(rect->x, y1);
+    gfx_vec2_t c3 = gfx_iso_screen_to_world(x1, y1);
+
+    // get the min and max tile coordinates between all the four corners, clamped to the tilemap
+    tile_min->x = max(min(min(c0.x, c1.x), min(c2.x, c3.x)), 0);
+    tile_max->x = min(max(max(c0.x, c1.x), max(c2.x, c3.x)), GFX_TILEMAP_WIDTH - 1);
+    tile_min->y = max(min(min(c0.y, c1.y), min(c2.y, c3.y)), 0);
+    tile_max->y = min(max(max(c0.y, c1.y), max(c2.y, c3.y)), GFX_TILEMAP_HEIGHT - 1);
+}
+
+// Adds the rows top to top + height of a bitmap to the drawables of a cell if they overlap the cell
+static uint8_t gfx_add_drawable(gfx_drawable_t *drawables, uint8_t count, const gfx_rect_t *cell,
+                                gfx_bitmap_t *bitmap, const int16_t x, const int16_t y,
+                                const int16_t top, int16_t height) {
+    if (bitmap == NULL || count >= GFX_COMPOSITOR_MAX_DRAWABLES) {
+        return count;
+    }
+
+    height = min(height, (int16_t)(bitmap->height - top));
+    if (height <= 0) {
+        return count;
+    }
+
+    if (x >= cell->x + cell->width || x + (int16_t)bitmap->width <= cell->x ||
+        y >= cell->y + cell->height || y + height <= cell->y) {
+        return count;
+    }
+
+    if (gfx_pack_bitmap(bitmap) == NULL) {
+        return count;
+    }
+
+    drawables[count] = (gfx_drawable_t){ bitmap, x, y, top, height };
+    return count + 1;
+}
+
+// Gets a tile by its row in the view, rather than its world row
+static uint8_t gfx_view_tile(const gfx_tilemap_t *map, const int16_t tx, const int16_t ty) {
+    int16_t row = GFX_TILEMAP_RING_ROW(map->top) + ty;
+    if (row >= GFX_TILEMAP_HEIGHT) {
+        row -= GFX_TILEMAP_HEIGHT;
+    }
+
+    return map->tiles[row * GFX_TILEMAP_WIDTH + tx];
+}
+
+// Amount of tilemaps of the active scene, the ground and its overlays
+static uint8_t gfx_layer_count() {
+    return 1 + active_scene->overlay_count;
+}
+
+// Gets a tilemap of the active scene, layer 0 is the ground and the overlays follow it
+static gfx_tilemap_t *gfx_layer(const uint8_t layer) {
+    return layer == 0 ? active_scene->tilemap : active_scene->overlays[layer - 1];
+}
+
+// Whether a tilemap is one of the layers of the active scene
+static bool gfx_is_layer(const gfx_tilemap_t *map) {
     if (active_scene == NULL) {
+        return false;
+    }
+
+    for (uint8_t layer = 0; layer < gfx_layer_count(); layer++) {
+        if (gfx_layer(layer) == map) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Gets the lowest layer that shows at a tile, the layers below an opaque overlay tile are hidden
+static uint8_t gfx_first_visible_layer(const int16_t tx, const int16_t ty) {
+    for (uint8_t layer = gfx_layer_count() - 1; layer > 0; layer--) {
+        const gfx_tilemap_t *map = gfx_layer(layer);
+
+        if ((map->flags & GFX_OPAQUE_BIT) != 0 && map->kinds[gfx_view_tile(map, tx, ty)] != NULL) {
+            return layer;
+        }
+    }
+
+    return 0;
+}
+
+// Collects everything that covers a cell, from back to front
+static uint8_t gfx_collect_drawables(gfx_drawable_t *drawables, const gfx_rect_t *cell) {
+    uint8_t count = 0;
+
+    gfx_vec2_t tile_min, tile_max;
+    gfx_tiles_in_rect(cell, &tile_min, &tile_max);
+
+    for (int16_t tx = tile_min.x; tx <= tile_max.x; tx++) {
+        for (int16_t ty = tile_min.y; ty <= tile_max.y; ty++) {
+            // the overlays of a tile over its ground, empty overlay tiles have no bitmap and are skipped
+            for (uint8_t layer = gfx_first_visible_layer(tx, ty); layer < gfx_layer_count(); layer++) {
+                const gfx_tilemap_t *map = gfx_layer(layer);
+                const int tile = gfx_view_tile(map, tx, ty);
+
+                count = gfx_add_drawable(drawables, count, cell, map->kinds[tile],
+                                         GFX_ISO_TILE_LEFT(tx, ty), GFX_ISO_TILE_TOP(tx, ty),
+                                         0, GFX_TILEMAP_TILE_HEIGHT);
+            }
+        }
+    }
+
+    // the tiles are flat ground (gfx_draw_tile clips them to their tile), so they never cover a sprite.
+    // the sprites are kept from back to front, which makes this the painter's order of the whole cell
+    for (uint8_t i = 0; i < active_scene->sprite_count; i++) {
+        const gfx_sprite_t *sprite = active_scene->sprites[i];
+        const gfx_rect_t rect = gfx_sprite_rect(sprite);
+
+        count = gfx_add_drawable(drawables, count, cell, sprite->bitmap, rect.x, rect.y,
+                                 (int16_t)(sprite->frame * sprite->size.y), sprite->size.y);
+    }
+
+    return count;
+}
+
+// Removes the least recently used palette from the palette cache, the colours after it move down
+static void gfx_evict_palette() {
+    const gfx_palette_slot_t evicted = palette_slots[0];
+
+    memmove(palette_pool + evicted.start * 2, palette_pool + (evicted.start + evicted.count) * 2,
+            (palette_pool_used - evicted.start - evicted.count) * 2);
+    palette_pool_used -= evicted.count;
+
+    palette_slot_count--;
+    for (uint8_t i = 0; i < palette_slot_count; i++) {
+        palette_slots[i] = palette_slots[i + 1];
+        if (palette_slots[i].start > evicted.start) {
+            palette_slots[i].start -= evicted.count;
+        }
+    }
+}
+
+/*
+Gets the palette of a bitmap into the palette cache, palette is set to NULL for bitmaps without a palette.
+When the cache is full the least recently used palettes make room, so a palette is only valid until the next call.
+Returns false if the palette can't be loaded.
+*/
+static bool gfx_load_palette(File32 &f, const gfx_bitmap_t *bitmap, const uint8_t **palette) {
+    *palette = NULL;
+    if (bitmap->encoding != GFX_ASSET_ENCODING_PAL4 && bitmap->encoding != GFX_ASSET_ENCODING_PAL8) {
+        return true;
+    }
+
+    for (uint8_t i = 0; i < palette_slot_count; i++) {
+        if (palette_slots[i].offset == bitmap->offset) {
+            // most recently used goes last
+            const gfx_palette_slot_t slot = palette_slots[i];
+            for (; i + 1 < palette_slot_count; i++) {
+                palette_slots[i] = palette_slots[i + 1];
+            }
+            palette_slots[i] = slot;
+
+            *palette = palette_pool + slot.start * 2;
+            return true;
+        }
+    }
+
+    // the palette follows the row table
+    uint8_t count;
+    f.seek(bitmap->offset + (uint32_t)bitmap->height * 4);
+    if (f.read(&count, 1) != 1 || count > GFX_PALETTE_CACHE_COLOURS) {
+        return false;
+    }
+
+    while (palette_slot_count == GFX_PALETTE_CACHE_SLOTS || palette_pool_used + count > GFX_PALETTE_CACHE_COLOURS) {
+        gfx_evict_palette();
+    }
+
+    uint8_t *colours = palette_pool + palette_pool_used * 2;
+    if (f.read(colours, count * 2) != count * 2) {
+        return false;
+    }
+
+    palette_slots[palette_slot_count++] = (gfx_palette_slot_t){ bitmap->offset, palette_pool_used, count };
+    palette_pool_used += count;
+
+    *palette = colours;
+    return true;
+}
+
+// Gets the amount of bytes a run of pixels takes up in the pack
+static uint16_t gfx_pixel_bytes(const gfx_bitmap_t *bitmap, const uint16_t pixels) {
+    switch (bitmap->encoding) {
+        case GFX_ASSET_ENCODING_PAL4:
+            return (pixels + 1) / 2;
+        case GFX_ASSET_ENCODING_PAL8:
+            return pixels;
+        default:
+            return pixels * 2;
+    }
+}
+
+/*
+Reads count pixels of the run at run_start, starting at pixel first of the run, into dst as big-endian RGB565.
+Palette indices are read into the start of dst and expanded from the last pixel to the first,
+every pixel being written past the indices that are still to be expanded, so no second buffer is needed.
+*/
+static void gfx_read_pixels(File32 &f, const gfx_bitmap_t *bitmap, const uint8_t *palette, const uint32_t run_start,
+                            uint8_t *dst, const uint16_t first, const uint16_t count) {
+    if (bitmap->encoding == GFX_ASSET_ENCODING_PAL4) {
+        const uint8_t odd = first & 1; // the first pixel is in the low nibble
+        f.seek(run_start + first / 2);
+        f.read(dst, gfx_pixel_bytes(bitmap, odd + count));
+
+        for (int16_t i = count - 1; i >= 0; i--) {
+            const uint8_t indices = dst[(odd + i) / 2];
+            const uint8_t index = ((odd + i) & 1) ? (indices & 0x0F) : (indices >> 4);
+            dst[i * 2] = palette[index * 2];
+            dst[i * 2 + 1] = palette[index * 2 + 1];
+        }
+    } else if (bitmap->encoding == GFX_ASSET_ENCODING_PAL8) {
+        f.seek(run_start + first);
+        f.read(dst, count);
+
+        for (int16_t i = count - 1; i >= 0; i--) {
+            const uint8_t index = dst[i];
+            dst[i * 2] = palette[index * 2];
+            dst[i * 2 + 1] = palette[index * 2 + 1];
+        }
+    } else {
+        f.seek(run_start + first * 2);
+        f.read(dst, count * 2);
+    }
+}
+
+/*
+Reads the header of the next run of a row into run (skip, length). Returns true if the run is a single colour,
+the colour is then read as well. Otherwise the file position is left at the pixels of the run.
+*/
+static bool gfx_read_run(File32 &f, const gfx_bitmap_t *bitmap, uint8_t *run, uint16_t *colour) {
+    if (bitmap->encoding != GFX_ASSET_ENCODING_FILL) {
+        f.read(run, 2);
+        return false;
+    }
+
+    uint8_t header[5]; // skip, length, fill, colour (big-endian)
+    f.read(header, 3);
+    run[0] = header[0];
+    run[1] = header[1];
+
+    if (header[2] == 0) {
+        return false;
+    }
+
+    f.read(header + 3, 2);
+    *colour = (uint16_t)(header[3] << 8) | header[4];
+    return true;
+}
+
+// Gets the file position of a row of a bitmap
+static uint32_t gfx_row_position(File32 &f, const gfx_bitmap_t *bitmap, const int16_t row) {
+    if (bitmap->encoding == GFX_ASSET_ENCODING_RAW) {
+        return bitmap->offset + (uint32_t)row * bitmap->width * 2;
+    }
+
+    uint32_t row_offset;
+    f.seek(bitmap->offset + (uint32_t)row * 4);
+    f.read(&row_offset, 4);
+    return row_offset;
+}
+
+// Gets a line of the cell buffer by its screen y
+static uint8_t *gfx_cell_line(const gfx_rect_t *cell, const int16_t y) {
+    return cell_buffer + (y - cell->y) * GFX_COMPOSITOR_CELL_WIDTH * 2;
+}
+
+// Copies the part of a run starting at the current file position that lies within the cell into a line of the cell,
+// the file position is left at the end of the run
+static void gfx_composite_run(File32 &f, const gfx_bitmap_t *bitmap, const uint8_t *palette, uint8_t *line,
+                              const int16_t run_x, const int16_t run_end, const gfx_rect_t *cell) {
+    const int16_t span_start = max(run_x, cell->x);
+    const int16_t span_end = min(run_end, (int16_t)(cell->x + cell->width));
+    const uint32_t run_start = f.curPosition();
+
+    if (span_start < span_end) {
+        gfx_read_pixels(f, bitmap, palette, run_start, line + (span_start - cell->x) * 2,
+                        span_start - run_x, span_end - span_start);
+    }
+
+    f.seek(run_start + gfx_pixel_bytes(bitmap, run_end - run_x));
+}
+
+// Copies the part of a single coloured run that lies within the cell into a line of the cell
+static void gfx_composite_fill(const uint16_t colour, uint8_t *line, const int16_t run_x, const int16_t run_end,
+                               const gfx_rect_t *cell) {
+    const int16_t span_start = max(run_x, cell->x);
+    const int16_t span_end = min(run_end, (int16_t)(cell->x + cell->width));
+
+    for (int16_t x = span_start; x < span_end; x++) {
+        line[(x - cell->x) * 2] = (uint8_t)(colour >> 8);
+        line[(x - cell->x) * 2 + 1] = (uint8_t)(colour & 0xFF);
+    }
+}
+
+// Copies the opaque runs of the row at the current file position into a line of the cell
+static void gfx_composite_row(File32 &f, const gfx_bitmap_t *bitmap, const uint8_t *palette, uint8_t *line,
+                              const int16_t x, const gfx_rect_t *cell) {
+    if (bitmap->encoding == GFX_ASSET_ENCODING_RAW) {
+        gfx_composite_run(f, bitmap, palette, line, x, x + bitmap->width, cell);
         return;
     }
 
-    // whole tilemap is dirty, redraw everything
-    if ((active_scene->tilemap->flags & GFX_DIRTY_BIT) != 0) {
-        tft.fillScreen(GFX_CONFIG_BACKGROUND_COLOUR);
+    uint8_t run_count;
+    f.read(&run_count, 1);
 
-        // iterate over all tiles and draw them, clip is set to GFX_FULLSCREEN
-        for (int16_t tx = 0; tx < GFX_TILEMAP_WIDTH; tx++) {
-            for (int16_t ty = 0; ty < GFX_TILEMAP_HEIGHT; ty++) {
-                const int idx = ty * GFX_TILEMAP_WIDTH + tx;
-                const int tile = active_scene->tilemap->tiles[idx];
+    int16_t run_x = x;
+
+    for (uint8_t r = 0; r < run_count; r++) {
+        uint8_t run[2]; // skip, length
+        uint16_t colour;
+        const bool fill = gfx_read_run(f, bitmap, run, &colour);
 
-                gfx_draw_tile({tx, ty}, active_scene->tilemap->kinds[tile], GFX_FULLSCREEN);
+        run_x += run[0];
+        if (fill) {
+            gfx_composite_fill(colour, line, run_x, run_x + run[1], cell);
+        } else {
+            gfx_composite_run(f, bitmap, palette, line, run_x, run_x + run[1], cell);
+        }
+        run_x += run[1];
+    }
+}
+
+// Gets the parts of a cell that HUD widgets cover, returns the amount of them
+static uint8_t gfx_collect_hud(gfx_rect_t *covered, const gfx_rect_t *cell) {
+    uint8_t count = 0;
+
+    for (uint8_t i = 0; i < gfx_hud_count(); i++) {
+        const gfx_rect_t rect = gfx_hud_rect(gfx_hud_get(i));
+        const int16_t x0 = max(rect.x, cell->x);
+        const int16_t y0 = max(rect.y, cell->y);
+        const int16_t x1 = min((int16_t)(rect.x + rect.width), (int16_t)(cell->x + cell->width));
+        const int16_t y1 = min((int16_t)(rect.y + rect.height), (int16_t)(cell->y + cell->height));
+
+        if (x0 < x1 && y0 < y1) {
+            covered[count++] = (gfx_rect_t){ x0, y0, (int16_t)(x1 - x0), (int16_t)(y1 - y0) };
+        }
+    }
+
+    return count;
+}
+
+// Whether a HUD widget covers part of a line
+static bool gfx_line_covered(const int16_t y, const gfx_rect_t *covered, const uint8_t count) {
+    for (uint8_t i = 0; i < count; i++) {
+        if (y >= covered[i].y && y < covered[i].y + covered[i].height) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Sends the parts of a composited line that no HUD widget covers, each in its own address window
+static void gfx_write_uncovered(const uint8_t *line, const gfx_rect_t *cell, const int16_t y,
+                                const gfx_rect_t *covered, const uint8_t count) {
+    const int16_t end = cell->x + cell->width;
+    int16_t x = cell->x;
+
+    while (x < end) {
+        int16_t span_end = end;
+        bool hidden = false;
+
+        for (uint8_t i = 0; i < count && !hidden; i++) {
+            if (y < covered[i].y || y >= covered[i].y + covered[i].height) {
+                continue;
             }
+
+            if (covered[i].x <= x && x < covered[i].x + covered[i].width) {
+                x = covered[i].x + covered[i].width;
+                hidden = true;
+            } else if (covered[i].x > x) {
+                span_end = min(span_end, covered[i].x);
+            }
+        }
+
+        if (hidden) {
+            continue;
+        }
+
+        tft.setAddrWindow(x, y, span_end - x, 1);
+        gfx_write_span(line + (x - cell->x) * 2, span_end - x);
+        x = span_end;
+    }
+}
+
+/*
+Renders a cell of at most GFX_COMPOSITOR_CELL_WIDTH by GFX_COMPOSITOR_CELL_HEIGHT pixels.
+The cell is blended in the cell buffer from the background, the covering tiles and the sprites, from back to front,
+and is then sent to the TFT once. Nothing is ever drawn over on screen, so sprites don't flicker.
+Every drawable is blended as a whole: its rows in the cell follow each other in the pack, so they are read in one go and
+a drawable costs the same sector reads as drawing it on its own. SdFat caches a single sector, going from drawable to
+drawable on every line would reload it for almost every row.
+The pixels of HUD widgets are skipped, the widgets stay on screen as they are.
+The drawables that were read from the card are returned.
+*/
+static uint8_t gfx_composite_cell(File32 &f, const gfx_rect_t *cell) {
+    gfx_drawable_t drawables[GFX_COMPOSITOR_MAX_DRAWABLES];
+    const uint8_t count = gfx_collect_drawables(drawables, cell);
+    uint8_t reads = 0;
+
+    for (int16_t i = 0; i < cell->height * GFX_COMPOSITOR_CELL_WIDTH; i++) {
+        cell_buffer[i * 2] = (uint8_t)(GFX_CONFIG_BACKGROUND_COLOUR >> 8);
+        cell_buffer[i * 2 + 1] = (uint8_t)(GFX_CONFIG_BACKGROUND_COLOUR & 0xFF);
+    }
+
+    for (uint8_t i = 0; i < count; i++) {
+        const gfx_drawable_t *drawable = &drawables[i];
+        const int16_t first = max(drawable->y, cell->y);
+        const int16_t end = min((int16_t)(drawable->y + drawable->height), (int16_t)(cell->y + cell->height));
+
+        const uint8_t *palette;
+        if (first >= end || !gfx_load_palette(f, drawable->bitmap, &palette)) {
+            continue;
         }
 
-        // remove dirty bit
-        active_scene->tilemap->flags &= ~GFX_DIRTY_BIT;
+        // the first row comes from the row table, the next rows follow directly after it
+        f.seek(gfx_row_position(f, drawable->bitmap, drawable->top + first - drawable->y));
+        reads++;
+        for (int16_t y = first; y < end; y++) {
+            gfx_composite_row(f, drawable->bitmap, palette, gfx_cell_line(cell, y), drawable->x, cell);
+        }
     }
 
-    // iterate over dirty rects
-    for (uint8_t i = 0; i < dirty_rects_count; i++) {
-        gfx_rect_t *rect = &dirty_rects[i];
+    gfx_rect_t covered[GFX_HUD_MAX_WIDGETS];
+    const uint8_t covered_count = gfx_collect_hud(covered, cell);
 
-        // bottom-right corner
-        int16_t x1 = rect->x + rect->width - 1;
-        int16_t y1 = rect->y + rect->height - 1;
+    // the SD card shares the SPI bus, so the TFT may only be selected after all reads
+    tft.startWrite();
 
-        // get the world position of *all* four corners.
-        gfx_vec2_t c0 = gfx_screen_to_world((gfx_vec2_t){rect->x, rect->y});
-        gfx_vec2_t c1 = gfx_screen_to_world((gfx_vec2_t){x1, rect->y});
-        gfx_vec2_t c2 = gfx_screen_to_world((gfx_vec2_t){rect->x, y1});
-        gfx_vec2_t c3 = gfx_screen_to_world((gfx_vec2_t){x1, y1});
+    // lines follow each other in the address window until a line has to skip a widget
+    bool windowed = false;
+    for (int16_t y = cell->y; y < cell->y + cell->height; y++) {
+        const uint8_t *line = gfx_cell_line(cell, y);
 
-        // get the min and max tile coordinates between all the four corners
-        int16_t tx_min = min(min(c0.x, c1.x), min(c2.x, c3.x));
-        int16_t tx_max = max(max(c0.x, c1.x), max(c2.x, c3.x));
-        int16_t ty_min = min(min(c0.y, c1.y), min(c2.y, c3.y));
-        int16_t ty_max = max(max(c0.y, c1.y), max(c2.y, c3.y));
+        if (gfx_line_covered(y, covered, covered_count)) {
+            gfx_write_uncovered(line, cell, y, covered, covered_count);
+            windowed = false;
+            continue;
+        }
+
+        if (!windowed) {
+            tft.setAddrWindow(cell->x, y, cell->width, cell->y + cell->height - y);
+            windowed = true;
+        }
+        gfx_write_span(line, cell->width);
+    }
 
-        // we iterate over all tiles and redraw with the dirty rect as the clip area.
-        for (int16_t tx = tx_min; tx <= tx_max; tx++) {
-            for (int16_t ty = ty_min; ty <= ty_max; ty++) {
-                if (tx < 0 || ty < 0 || tx >= GFX_TILEMAP_WIDTH || ty >= GFX_TILEMAP_HEIGHT)
-                    continue;
-                const int idx = ty * GFX_TILEMAP_WIDTH + tx; // (x, y) -> idx
-                const int tile = active_scene->tilemap->tiles[idx];
-                gfx_draw_tile((gfx_vec2_t){tx, ty}, active_scene->tilemap->kinds[tile], *rect);
+    tft.endWrite();
+
+    return reads;
+}
+
+/*
+Renders a screen area cell by cell, a band of cells at a time, for as long as the budget lasts.
+The first band is always drawn, so every frame makes progress. The rect is shrunk to the bands that are left,
+the budget is charged for the pixels drawn and the drawables read.
+*/
+static void gfx_composite_rect(File32 &f, gfx_rect_t *rect, gfx_budget_t *budget) {
+    while (rect->height > 0 && budget->pixels > 0 && budget->reads > 0) {
+        const int16_t band = min((int16_t)GFX_COMPOSITOR_CELL_HEIGHT, rect->height);
+
+        for (int16_t x = rect->x; x < rect->x + rect->width; x += GFX_COMPOSITOR_CELL_WIDTH) {
+            const gfx_rect_t cell = {
+                x,
+                rect->y,
+                min((int16_t)GFX_COMPOSITOR_CELL_WIDTH, (int16_t)(rect->x + rect->width - x)),
+                band
+            };
+
+            budget->reads -= gfx_composite_cell(f, &cell);
+        }
+
+        budget->pixels -= (int32_t)rect->width * band;
+        rect->y += band;
+        rect->height -= band;
+    }
+}
+
+/*
+Advances the scrolling transition by a step. The panel shows frame memory line (start + y) of the scroll area at
+screen line y, so raising the start line moves the screen up and the lines that wrap around appear at the bottom.
+Those are exactly the lines where the new scene belongs, so the scene is drawn at its own coordinates and is in
+place when the start line wraps back to the top. Only the lines that have scrolled in are drawn: the damage below them
+is dropped, it is drawn when the lines scroll in.
+*/
+static void gfx_scroll_step(File32 &f) {
+    const int16_t revealed = GFX_SCROLL_TOP_FIXED + scroll_progress;
+    const int16_t step = min((int16_t)GFX_SCROLL_STEP, (int16_t)(GFX_SCROLL_AREA - scroll_progress));
+
+    scroll_progress += step;
+    tft.scrollTo(GFX_SCROLL_TOP_FIXED + scroll_progress % GFX_SCROLL_AREA);
+    gfx_damage_push({0, revealed, GFX_SCREEN_WIDTH, step});
+
+    // the fixed lines keep the old screen until the end
+    const bool done = scroll_progress == GFX_SCROLL_AREA;
+    if (done && GFX_SCROLL_TOP_FIXED > 0) {
+        gfx_damage_push({0, 0, GFX_SCREEN_WIDTH, GFX_SCROLL_TOP_FIXED});
+    }
+
+    const int16_t top = done ? 0 : GFX_SCROLL_TOP_FIXED;
+    const int16_t bottom = GFX_SCROLL_TOP_FIXED + scroll_progress;
+
+    for (uint8_t i = 0; i < gfx_damage_count(); i++) {
+        gfx_rect_t rect = *gfx_damage_get(i);
+
+        const int16_t y0 = max(rect.y, top);
+        const int16_t y1 = min((int16_t)(rect.y + rect.height), bottom);
+        if (y0 >= y1) {
+            continue;
+        }
+
+        // lines that are on screen may not be left for later, so the budget does not apply
+        gfx_budget_t unlimited = {INT32_MAX, INT16_MAX};
+        rect.y = y0;
+        rect.height = y1 - y0;
+        gfx_composite_rect(f, &rect, &unlimited);
+    }
+}
+
+// Whether any sprite of the scene is in a screen area
+static bool gfx_has_sprite(const gfx_rect_t *rect) {
+    for (uint8_t i = 0; i < active_scene->sprite_count; i++) {
+        const gfx_rect_t sprite = gfx_sprite_rect(active_scene->sprites[i]);
+
+        if (sprite.x < rect->x + rect->width && rect->x < sprite.x + sprite.width &&
+            sprite.y < rect->y + rect->height && rect->y < sprite.y + sprite.height) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Whether gfx_set_viewport left the tile at a view position stale
+static bool gfx_tile_stale(const int16_t tx, const int16_t ty) {
+    const uint8_t i = ty * GFX_TILEMAP_WIDTH + tx;
+    return (stale_tiles[i / 8] & (1 << (i % 8))) != 0;
+}
+
+/*
+Draws the tiles of the view positions gfx_set_viewport left stale straight to the screen, layer by layer like a full
+redraw. Tiles don't overlap, so a position is drawn without its neighbours. The sprites that were drawn over are
+composited again. Returns whether anything was drawn.
+*/
+static bool gfx_draw_stale_tiles() {
+    bool drawn = false;
+
+    for (uint8_t layer = 0; layer < gfx_layer_count(); layer++) {
+        const gfx_tilemap_t *map = gfx_layer(layer);
+
+        for (int16_t tx = 0; tx < GFX_TILEMAP_WIDTH; tx++) {
+            for (int16_t ty = 0; ty < GFX_TILEMAP_HEIGHT; ty++) {
+                if (gfx_tile_stale(tx, ty) && gfx_first_visible_layer(tx, ty) <= layer) {
+                    gfx_draw_tile({tx, ty}, map->kinds[gfx_view_tile(map, tx, ty)], GFX_FULLSCREEN);
+                    drawn = true;
+                }
             }
         }
     }
 
-    // draw sprites
-    for (uint8_t i = 0; i < active_scene->sprite_count; i++)
-    {
-        gfx_sprite_t *sprite = active_scene->sprites[i];
+    for (int16_t tx = 0; tx < GFX_TILEMAP_WIDTH; tx++) {
+        for (int16_t ty = 0; ty < GFX_TILEMAP_HEIGHT; ty++) {
+            if (!gfx_tile_stale(tx, ty)) {
+                continue;
+            }
+
+            const gfx_rect_t tile = {
+                (int16_t)GFX_ISO_TILE_LEFT(tx, ty),
+                (int16_t)GFX_ISO_TILE_TOP(tx, ty),
+                GFX_TILEMAP_TILE_WIDTH,
+                GFX_TILEMAP_TILE_HEIGHT
+            };
+            for (uint8_t i = 0; i < active_scene->sprite_count; i++) {
+                const gfx_rect_t sprite = gfx_sprite_rect(active_scene->sprites[i]);
+
+                if (sprite.x < tile.x + tile.width && tile.x < sprite.x + sprite.width &&
+                    sprite.y < tile.y + tile.height && tile.y < sprite.y + sprite.height) {
+                    gfx_damage_push(sprite);
+                }
+            }
+        }
+    }
+
+    memset(stale_tiles, 0, sizeof(stale_tiles));
+    return drawn;
+}
 
-        // redraw if dirty
-        if ((sprite->flags & GFX_DIRTY_BIT) != 0) {
-            gfx_draw_sprite(sprite);
+void gfx_frame() {
+    // exit if no scene is defined
+    if (active_scene == NULL) {
+        return;
+    }
+
+    // too much damage to track, redraw everything
+    if (gfx_damage_overflowed()) {
+        gfx_invalidate_tilemap(active_scene->tilemap);
+    }
+
+    // a whole layer is dirty, redraw everything.
+    // tiles are drawn one by one here, their rows are read in order which keeps the SD card's sector cache warm.
+    bool redrawn = false;
+    for (uint8_t layer = 0; layer < gfx_layer_count(); layer++) {
+        redrawn |= (gfx_layer(layer)->flags & GFX_DIRTY_BIT) != 0;
+    }
+
+    gfx_rect_t deferred[GFX_TILEMAP_MAX_DIRTY_PER_FRAME];
+    uint8_t deferred_count = 0;
+    bool scrolled_in = false; // a scrolling transition ended in this frame
+    bool tiles_drawn = false; // stale tiles were drawn straight to the screen
+    if (redrawn) {
+        gfx_scroll_stop();
+        memset(stale_tiles, 0, sizeof(stale_tiles));
+
+        tft.fillScreen(GFX_CONFIG_BACKGROUND_COLOUR);
+
+        // iterate over all tiles of every layer and draw them, clip is set to GFX_FULLSCREEN
+        for (uint8_t layer = 0; layer < gfx_layer_count(); layer++) {
+            gfx_tilemap_t *map = gfx_layer(layer);
+
+            for (int16_t tx = 0; tx < GFX_TILEMAP_WIDTH; tx++) {
+                for (int16_t ty = 0; ty < GFX_TILEMAP_HEIGHT; ty++) {
+                    if (gfx_first_visible_layer(tx, ty) > layer) {
+                        continue;
+                    }
+
+                    const int tile = gfx_view_tile(map, tx, ty);
+                    gfx_draw_tile({tx, ty}, map->kinds[tile], GFX_FULLSCREEN);
+                }
+            }
 
             // remove dirty bit
-            sprite->flags &= ~GFX_DIRTY_BIT;
+            map->flags &= ~GFX_DIRTY_BIT;
+        }
+
+        // from back to front, over the ground
+        for (uint8_t i = 0; i < active_scene->sprite_count; i++) {
+            gfx_draw_sprite(active_scene->sprites[i]);
+        }
+    } else if (gfx_scrolling()) {
+        File32 *f = gfx_pack();
+        if (f == NULL) {
+            return;
+        }
+
+        // the whole scene is drawn as it scrolls in
+        memset(stale_tiles, 0, sizeof(stale_tiles));
+        gfx_scroll_step(*f);
+        scrolled_in = !gfx_scrolling();
+    } else {
+        // the tiles a moved view left stale go first, the damage is composited over them
+        tiles_drawn = gfx_draw_stale_tiles();
+
+        if (gfx_damage_count() > 0) {
+            File32 *f = gfx_pack();
+            if (f == NULL) {
+                return;
+            }
+
+            // iterate over dirty rects, sprites are composited into them.
+            // rects with sprites go first, what doesn't fit in the budget is left for the next frame
+            gfx_budget_t budget = {GFX_FRAME_PIXEL_BUDGET, GFX_FRAME_READ_BUDGET};
+            for (uint8_t pass = 0; pass < 2; pass++) {
+                for (uint8_t i = 0; i < gfx_damage_count(); i++) {
+                    gfx_rect_t rect = *gfx_damage_get(i);
+                    if (gfx_has_sprite(&rect) != (pass == 0)) {
+                        continue;
+                    }
+
+                    gfx_composite_rect(*f, &rect, &budget);
+                    if (rect.height > 0) {
+                        deferred[deferred_count++] = rect;
+                    }
+                }
+            }
         }
     }
 
-    // clear dirty rects
-    dirty_rects_count = 0;
+    // every sprite is up to date now
+    for (uint8_t i = 0; i < active_scene->sprite_count; i++) {
+        active_scene->sprites[i]->flags &= ~GFX_DIRTY_BIT;
+    }
+
+    // the HUD goes on top, widgets the scene was drawn over are drawn again.
+    // while the screen scrolls the widgets would land in the wrong lines, they are drawn once it is back in place
+    if (!gfx_scrolling()) {
+        gfx_hud_frame(redrawn || scrolled_in || tiles_drawn);
+    }
+
+    // clear dirty rects, the deferred ones are the first damage of the next frame
+    gfx_damage_end_frame();
+    for (uint8_t i = 0; i < deferred_count; i++) {
+        gfx_damage_push(deferred[i]);
+    }
 }
 
 void gfx_reset() {
+    gfx_scroll_stop();
     active_scene = NULL;
-    dirty_rects_count = 0;
+    gfx_damage_reset();
+    gfx_hud_reset();
+    gfx_anim_reset();
     tft.fillScreen(GFX_CONFIG_BACKGROUND_COLOUR);
 }
 
+// Gets the depth of the tile a sprite stands on, the sprite's position is the top corner of that tile
+static int16_t gfx_sprite_depth(const gfx_sprite_t *sprite) {
+    const gfx_vec2_t tile = gfx_iso_screen_to_world(sprite->position.x,
+                                                    sprite->position.y + GFX_TILEMP_TILE_HALF_HEIGHT);
+    return tile.x + tile.y;
+}
+
+// Whether sprite a is drawn behind sprite b
+static bool gfx_sprite_behind(const gfx_sprite_t *a, const gfx_sprite_t *b) {
+    return a->depth < b->depth || (a->depth == b->depth && a->layer < b->layer);
+}
+
+// Restores the back to front order of the sprites after a single sprite changed its depth.
+// An insertion sort, the list is at most one sprite away from sorted so this is a single pass
+static void gfx_sort_sprites() {
+    for (uint8_t i = 1; i < active_scene->sprite_count; i++) {
+        gfx_sprite_t *sprite = active_scene->sprites[i];
+        uint8_t j = i;
+
+        for (; j > 0 && gfx_sprite_behind(sprite, active_scene->sprites[j - 1]); j--) {
+            active_scene->sprites[j] = active_scene->sprites[j - 1];
+        }
+        active_scene->sprites[j] = sprite;
+    }
+}
+
 bool gfx_add_sprite(gfx_sprite_t *sprite) {
     if (active_scene == NULL) {
         return false;
@@ -150,7 +966,9 @@ bool gfx_add_sprite(gfx_sprite_t *sprite) {
         return false;
     }
 
+    sprite->depth = gfx_sprite_depth(sprite);
     active_scene->sprites[active_scene->sprite_count++] = sprite;
+    gfx_sort_sprites();
     gfx_invalidate_sprite(sprite);
 
     return true;
@@ -172,9 +990,20 @@ void gfx_remove_sprite(gfx_sprite_t *sprite)
 
 void gfx_move_sprite(gfx_sprite_t *sprite, const int16_t x, const int16_t y)
 {
+    // both the area it leaves and the area it moves to have to be composited again
     gfx_invalidate_sprite(sprite);
     sprite->position.x = x;
     sprite->position.y = y;
+    gfx_invalidate_sprite(sprite);
+
+    // sprites are reordered only when they step onto another diagonal, both areas are composited again anyway
+    const int16_t depth = gfx_sprite_depth(sprite);
+    if (depth != sprite->depth) {
+        sprite->depth = depth;
+        if (active_scene != NULL) {
+            gfx_sort_sprites();
+        }
+    }
 }
 
 void gfx_set_bitmap_sprite(gfx_sprite_t* sprite, gfx_bitmap_t* bitmap) {
@@ -182,136 +1011,206 @@ void gfx_set_bitmap_sprite(gfx_sprite_t* sprite, gfx_bitmap_t* bitmap) {
     sprite->bitmap = bitmap;
 }
 
-void gfx_draw_tile(gfx_vec2_t position, gfx_bitmap_t* bitmap, gfx_rect_t rect) {
-    File32 f = SD.open(bitmap->filename);
-    if (!f) {
+void gfx_set_frame_sprite(gfx_sprite_t *sprite, const uint8_t frame) {
+    if (sprite->frame == frame) {
         return;
     }
 
-    uint8_t row[bitmap->row_size];
+    gfx_invalidate_sprite(sprite);
+    sprite->frame = frame;
+}
 
-    const gfx_vec2_t screen_pos = gfx_world_to_screen({position.x, position.y});
-    const int16_t tile_x = screen_pos.x - GFX_TILEMP_TILE_HALF_WIDTH;
-    const int16_t tile_y = screen_pos.y;
+// Draws the part of a run starting at the current file position between start_x and end_x,
+// the file position is left at the end of the run
+static void gfx_blit_run(File32 &f, const gfx_bitmap_t *bitmap, const uint8_t *palette,
+                         const int16_t x, const int16_t y, const int16_t run_x, const int16_t run_end,
+                         const int16_t start_x, const int16_t end_x) {
+    const int16_t span_start = max(run_x, start_x);
+    const int16_t span_end = min(run_end, end_x);
+    const uint32_t run_start = f.curPosition();
+
+    uint8_t chunk[PIXELS_PER_READ * 2]; // 2 bytes per pixel
+
+    for (int16_t px = span_start; px < span_end; px += PIXELS_PER_READ) {
+        const int16_t chunk_length = min((int16_t)(span_end - px), (int16_t)PIXELS_PER_READ);
+        gfx_read_pixels(f, bitmap, palette, run_start, chunk, px - run_x, chunk_length);
+
+        // the SD card shares the SPI bus, so the TFT may only be selected after the read
+        tft.startWrite();
+        tft.setAddrWindow(x + px, y, chunk_length, 1);
+        gfx_write_span(chunk, chunk_length);
+        tft.endWrite();
+    }
 
-    int16_t start_x = max(0, rect.x - tile_x);
-    int16_t start_y = max(0, rect.y - tile_y);
-    int16_t end_x = min((int16_t)GFX_TILEMAP_TILE_WIDTH, (int16_t)(rect.x + rect.width - tile_x));
-    int16_t end_y = min((int16_t)GFX_TILEMAP_TILE_HEIGHT, (int16_t)(rect.y + rect.height - tile_y));
+    f.seek(run_start + gfx_pixel_bytes(bitmap, run_end - run_x));
+}
 
-    start_x = max(start_x, (int16_t)(0 - tile_x));
-    start_y = max(start_y, (int16_t)(0 - tile_y));
-    end_x = min(end_x, (int16_t)(tft.width() - tile_x));
-    end_y = min(end_y, (int16_t)(tft.height() - tile_y));
+// Draws the part of a single coloured run between start_x and end_x, the TFT repeats the colour itself
+static void gfx_blit_fill(const uint16_t colour, const int16_t x, const int16_t y,
+                          const int16_t run_x, const int16_t run_end, const int16_t start_x, const int16_t end_x) {
+    const int16_t span_start = max(run_x, start_x);
+    const int16_t span_end = min(run_end, end_x);
+    if (span_start >= span_end) {
+        return;
+    }
 
-    if (start_x >= end_x || start_y >= end_y) {
-        f.close();
+    tft.startWrite();
+    tft.setAddrWindow(x + span_start, y, span_end - span_start, 1);
+    tft.writeColor(colour, span_end - span_start);
+    tft.endWrite();
+}
+
+/*
+Draws the part of a bitmap between (start_x, start_y) and (end_x, end_y), in bitmap coordinates, at (x, y) on screen.
+Only the opaque runs are read from the pack, so transparent pixels never cost an SD read or a pixel push.
+*/
+static void gfx_blit_bitmap(File32 &f, const gfx_bitmap_t *bitmap, int16_t x, int16_t y,
+                            int16_t start_x, int16_t start_y, int16_t end_x, int16_t end_y) {
+    const uint8_t *palette;
+    if (!gfx_load_palette(f, bitmap, &palette)) {
         return;
     }
 
-    for (int16_t y = GFX_TILEMAP_TILE_HEIGHT - 1; y >= 0; y--) {
-        if (y < start_y || y >= end_y)
+    // rows are stored back to back, so only the first row needs a seek
+    f.seek(gfx_row_position(f, bitmap, start_y));
+
+    for (int16_t row = start_y; row < end_y; row++) {
+        if (bitmap->encoding == GFX_ASSET_ENCODING_RAW) {
+            gfx_blit_run(f, bitmap, palette, x, y + row, 0, bitmap->width, start_x, end_x);
             continue;
+        }
 
-        uint32_t rowOffset = bitmap->offset + (uint32_t)(GFX_TILEMAP_TILE_HEIGHT - 1 - y) * bitmap->row_size;
-        f.seek(rowOffset);
-        f.read(row, bitmap->row_size);
+        uint8_t run_count;
+        f.read(&run_count, 1);
 
-        int16_t span_start = -1;
+        int16_t run_x = 0;
 
-        for (int16_t x = start_x; x <= end_x; x++) {
-            bool is_transparent = false;
+        for (uint8_t r = 0; r < run_count; r++) {
+            uint8_t run[2]; // skip, length
+            uint16_t colour;
+            const bool fill = gfx_read_run(f, bitmap, run, &colour);
 
-            if (x < end_x) {
-                const uint8_t b = row[(x * 3) + 0];
-                const uint8_t g = row[(x * 3) + 1];
-                const uint8_t r = row[(x * 3) + 2];
-                is_transparent = ((r | g | b) == 0);
+            run_x += run[0];
+            if (fill) {
+                gfx_blit_fill(colour, x, y + row, run_x, run_x + run[1], start_x, end_x);
             } else {
-                is_transparent = true;
+                gfx_blit_run(f, bitmap, palette, x, y + row, run_x, run_x + run[1], start_x, end_x);
             }
+            run_x += run[1];
+        }
+    }
+}
 
-            if (!is_transparent && span_start == -1) {
-                span_start = x;
-            } else if ((is_transparent || x == end_x) && span_start != -1) {
-                int16_t span_width = x - span_start;
-                int16_t draw_x = tile_x + span_start;
-                int16_t draw_y = tile_y + y;
-
-                tft.startWrite();
-                tft.setAddrWindow(draw_x, draw_y, span_width, 1);
-
-                for (int16_t sx = span_start; sx < x; sx++) {
-                    const uint8_t b = row[(sx * 3) + 0];
-                    const uint8_t g = row[(sx * 3) + 1];
-                    const uint8_t r = row[(sx * 3) + 2];
-                    const uint16_t color = tft.color565(r, g, b);
-                    tft.pushColor(color);
-                }
+/*
+Streams a raw bitmap from the card to the TFT sector by sector, bypassing the file layer.
+Every sector is read into SdFat's sector cache, so this needs no extra RAM, and is written with Write Memory Continue,
+which makes the whole bitmap a single address window. A multi-sector read (CMD18) would save a command per sector,
+but keeps the card selected until the read is stopped, and the TFT shares the bus.
+Returns false if the bitmap can't be streamed, the caller then draws it through the file instead.
+*/
+static bool gfx_stream_bitmap(const gfx_bitmap_t *bitmap, const int16_t x, const int16_t y) {
+    // the pack must be contiguous and the bitmap sector aligned, so every sector holds whole pixels
+    if (bitmap->encoding != GFX_ASSET_ENCODING_RAW || pack_first_sector == 0 ||
+        bitmap->offset % GFX_ASSET_SECTOR_SIZE != 0) {
+        return false;
+    }
 
-                tft.endWrite();
-                span_start = -1;
-            }
+    uint8_t *sector_buffer = SD.cacheClear();
+    if (sector_buffer == NULL) {
+        return false;
+    }
+
+    uint32_t sector = pack_first_sector + bitmap->offset / GFX_ASSET_SECTOR_SIZE;
+    uint32_t remaining = (uint32_t)bitmap->width * bitmap->height * 2;
+    bool first = true;
+
+    while (remaining > 0) {
+        if (!SD.card()->readSector(sector++, sector_buffer)) {
+            return false;
         }
+
+        const uint16_t bytes = min(remaining, (uint32_t)GFX_ASSET_SECTOR_SIZE);
+
+        tft.startWrite();
+        if (first) {
+            tft.setAddrWindow(x, y, bitmap->width, bitmap->height);
+            first = false;
+        } else {
+            tft.writeCommand(ILI9341_WRITE_MEMORY_CONTINUE);
+        }
+        gfx_write_span(sector_buffer, bytes / 2);
+        tft.endWrite();
+
+        remaining -= bytes;
     }
 
-    f.close();
+    return true;
 }
 
-void gfx_draw_sprite(gfx_sprite_t* sprite) {
-    File32 f = SD.open(sprite->bitmap->filename);
-    if (!f) {
+void gfx_draw_tile(gfx_vec2_t position, gfx_bitmap_t* bitmap, gfx_rect_t rect) {
+    // empty overlay tile
+    if (bitmap == NULL) {
+        return;
+    }
+
+    const int16_t tile_x = GFX_ISO_TILE_LEFT(position.x, position.y);
+    const int16_t tile_y = GFX_ISO_TILE_TOP(position.x, position.y);
+
+    int16_t start_x = max(0, rect.x - tile_x);
+    int16_t start_y = max(0, rect.y - tile_y);
+    int16_t end_x = min((int16_t)GFX_TILEMAP_TILE_WIDTH, (int16_t)(rect.x + rect.width - tile_x));
+    int16_t end_y = min((int16_t)GFX_TILEMAP_TILE_HEIGHT, (int16_t)(rect.y + rect.height - tile_y));
+
+    start_x = max(start_x, (int16_t)(0 - tile_x));
+    start_y = max(start_y, (int16_t)(0 - tile_y));
+    end_x = min(end_x, (int16_t)(GFX_SCREEN_WIDTH - tile_x));
+    end_y = min(end_y, (int16_t)(GFX_SCREEN_HEIGHT - tile_y));
+
+    if (start_x >= end_x || start_y >= end_y) {
+        return;
+    }
+
+    File32 *f = gfx_pack_bitmap(bitmap);
+    if (f == NULL) {
         return;
     }
 
+    gfx_blit_bitmap(*f, bitmap, tile_x, tile_y, start_x, start_y, end_x, end_y);
+}
+
+void gfx_draw_sprite(gfx_sprite_t* sprite) {
     const int16_t sprite_x = sprite->position.x - (sprite->size.x / 2);
     const int16_t sprite_y = sprite->position.y;
 
-    uint8_t chunk[PIXELS_PER_READ * 3]; // 3 bytes per pixel
-
-    for (int16_t y = sprite->size.y - 1; y >= 0; y--) {
-        uint32_t rowOffset = sprite->bitmap->offset + (uint32_t)(sprite->size.y - 1 - y) * sprite->bitmap->row_size;
-        int16_t pixels_remaining = sprite->size.x;
-        int16_t x_pos = 0;
-
-        while (pixels_remaining > 0) {
-            int16_t chunk_length = min(pixels_remaining, PIXELS_PER_READ);
-            f.seek(x_pos * 3 + rowOffset);
-            f.read(chunk, chunk_length * 3);
-
-            int16_t span_start = -1;
-
-            for (int16_t sx = 0; sx < chunk_length; sx++) {
-                const uint8_t b = chunk[sx * 3 + 0];
-                const uint8_t g = chunk[sx * 3 + 1];
-                const uint8_t r = chunk[sx * 3 + 2];
-                bool is_transparent = (r | g | b) == 0;
-
-                if (!is_transparent && span_start == -1) {
-                    span_start = x_pos + sx;
-                } else if ((is_transparent || sx == chunk_length - 1) && span_start != -1) {
-                    int16_t span_end = (is_transparent) ? (x_pos + sx) : (x_pos + sx + 1);
-                    int16_t span_width = span_end - span_start;
-
-                    tft.startWrite();
-                    tft.setAddrWindow(sprite_x + span_start, sprite_y + y, span_width, 1);
-                    for (int16_t px = span_start; px < span_end; px++) {
-                        int16_t local_x = px - x_pos;
-                        uint8_t b = chunk[local_x * 3 + 0];
-                        uint8_t g = chunk[local_x * 3 + 1];
-                        uint8_t r = chunk[local_x * 3 + 2];
-                        tft.pushColor(tft.color565(r, g, b));
-                    }
-                    tft.endWrite();
-                    span_start = -1;
-                }
-            }
+    // clip against the screen
+    const int16_t start_x = max(0, -sprite_x);
+    const int16_t start_y = max(0, -sprite_y);
+    const int16_t end_x = min(sprite->size.x, (int16_t)(GFX_SCREEN_WIDTH - sprite_x));
+    const int16_t end_y = min(sprite->size.y, (int16_t)(GFX_SCREEN_HEIGHT - sprite_y));
 
-            x_pos += chunk_length;
-            pixels_remaining -= chunk_length;
-        }
+    if (start_x >= end_x || start_y >= end_y) {
+        return;
+    }
+
+    File32 *f = gfx_pack_bitmap(sprite->bitmap);
+    if (f == NULL) {
+        return;
+    }
+
+    // the frame is a band of rows of the sheet, the row table gets the blit straight to its first row
+    const int16_t top = (int16_t)(sprite->frame * sprite->size.y);
+    if (top + end_y > (int16_t)sprite->bitmap->height) {
+        return;
+    }
+
+    // an unclipped opaque sprite (like a fullscreen image) is streamed straight from the card
+    const bool unclipped = start_x == 0 && start_y == 0 &&
+                           end_x == (int16_t)sprite->bitmap->width && end_y == (int16_t)sprite->bitmap->height;
+    if (unclipped && gfx_stream_bitmap(sprite->bitmap, sprite_x, sprite_y)) {
+        return;
     }
-    f.close();
+
+    gfx_blit_bitmap(*f, sprite->bitmap, sprite_x, sprite_y - top, start_x, start_y + top, end_x, end_y + top);
 }
 
 
@@ -326,9 +1225,34 @@ void gfx_set_tilemap(gfx_tilemap_t *map) {
 
 void gfx_set_scene(gfx_scene_t *scene) {
     active_scene = scene;
+
+    // the scene may have been filled without gfx_add_sprite
+    for (uint8_t i = 0; i < scene->sprite_count; i++) {
+        scene->sprites[i]->depth = gfx_sprite_depth(scene->sprites[i]);
+    }
+    gfx_sort_sprites();
     gfx_invalidate_tilemap(scene->tilemap);
 }
 
+void gfx_scroll_transition() {
+    // everything is drawn as it scrolls in
+    scroll_progress = 0;
+    gfx_damage_reset();
+}
+
+bool gfx_scrolling() {
+    return scroll_progress < GFX_SCROLL_AREA;
+}
+
+void gfx_scroll_stop() {
+    if (!gfx_scrolling()) {
+        return;
+    }
+
+    scroll_progress = GFX_SCROLL_AREA;
+    tft.scrollTo(GFX_SCROLL_TOP_FIXED);
+}
+
 void gfx_invalidate_tilemap(gfx_tilemap_t *map) {
     map->flags |= GFX_DIRTY_BIT;
 
@@ -338,86 +1262,100 @@ void gfx_invalidate_tilemap(gfx_tilemap_t *map) {
 }
 
 void gfx_push_dirty_rect(const int16_t x, const int16_t y, const int16_t width, const int16_t height) {
-    dirty_rects[dirty_rects_count++] = (gfx_rect_t){
+    gfx_damage_push((gfx_rect_t){
         .x = x,
         .y = y,
         .width = width,
-        .height = height};
+        .height = height});
 }
 
 void gfx_invalidate_tile(gfx_tilemap_t *map, const int16_t tx, const int16_t ty) {
-    if (map != active_scene->tilemap) {
+    if (!gfx_is_layer(map) || gfx_tilemap_row(map, ty) == NULL) {
         return;
     }
 
-    gfx_vec2_t screen_pos = gfx_world_to_screen((gfx_vec2_t){tx, ty});
     gfx_push_dirty_rect(
-        screen_pos.x - GFX_TILEMP_TILE_HALF_WIDTH,
-        screen_pos.y,
+        GFX_ISO_TILE_LEFT(tx, ty - map->top),
+        GFX_ISO_TILE_TOP(tx, ty - map->top),
         GFX_TILEMAP_TILE_WIDTH,
         GFX_TILEMAP_TILE_HEIGHT);
 }
 
 void gfx_set_tile(gfx_tilemap_t *map, int16_t tx, int16_t ty, uint8_t kind) {
-    map->tiles[ty * GFX_TILEMAP_WIDTH + tx] = kind;
+    uint8_t *row = gfx_tilemap_row(map, ty);
+    if (row == NULL) {
+        return;
+    }
+
+    row[tx] = kind;
     gfx_invalidate_tile(map, tx, ty);
 }
 
 uint8_t gfx_get_tile(gfx_tilemap_t *map, int16_t tx, int16_t ty) {
-    return map->tiles[ty * GFX_TILEMAP_WIDTH + tx];
+    const uint8_t *row = gfx_tilemap_row(map, ty);
+    return row != NULL ? row[tx] : 0;
 }
 
-void gfx_invalidate_sprite(gfx_sprite_t *sprite) {
-    if ((sprite->flags & GFX_DIRTY_BIT) != 0) {
-        return;
+uint8_t *gfx_tilemap_row(gfx_tilemap_t *map, const int16_t ty) {
+    if (ty < map->top || ty >= map->top + GFX_TILEMAP_HEIGHT) {
+        return NULL;
     }
 
-    sprite->flags |= GFX_DIRTY_BIT;
-
-    const int16_t x0 = sprite->position.x - (sprite->size.x / 2);
-    const int16_t y0 = sprite->position.y;
-    const int16_t x1 = x0 + sprite->size.x;
-    const int16_t y1 = y0 + sprite->size.y;
+    return &map->tiles[GFX_TILEMAP_RING_ROW(ty) * GFX_TILEMAP_WIDTH];
+}
 
-    gfx_push_dirty_rect(x0, y0, sprite->size.x, sprite->size.y);
+void gfx_set_viewport(gfx_tilemap_t *map, const int16_t top) {
+    const int16_t previous = map->top;
+    map->top = top;
 
-    for (uint8_t i = 0; i < active_scene->sprite_count; i++) {
-        gfx_sprite_t *other = active_scene->sprites[i];
-
-        if (other == sprite) continue;
-        if ((other->flags & GFX_DIRTY_BIT) != 0) continue;
+    if (!gfx_is_layer(map)) {
+        map->flags |= GFX_DIRTY_BIT;
+        return;
+    }
 
-        const int16_t ox0 = other->position.x - (other->size.x / 2);
-        const int16_t oy0 = other->position.y;
-        const int16_t ox1 = ox0 + other->size.x;
-        const int16_t oy1 = oy0 + other->size.y;
+    // every tile moves on screen diagonally, so the panel's vertical scrolling can't move them. A view position
+    // shows the tile of another row now, it is only drawn again if that tile looks different.
+    // the rows that come into view aren't filled yet, they are always drawn
+    for (int16_t ty = 0; ty < GFX_TILEMAP_HEIGHT; ty++) {
+        const bool incoming = top + ty < previous || top + ty >= previous + GFX_TILEMAP_HEIGHT;
+        const uint8_t *shown = &map->tiles[GFX_TILEMAP_RING_ROW(previous + ty) * GFX_TILEMAP_WIDTH];
 
-        if (x0 < ox1 && x1 > ox0 && y0 < oy1 && y1 > oy0) {
-            gfx_invalidate_sprite(other);
+        for (int16_t tx = 0; tx < GFX_TILEMAP_WIDTH; tx++) {
+            if (incoming || map->kinds[shown[tx]] != map->kinds[gfx_view_tile(map, tx, ty)]) {
+                const uint8_t i = ty * GFX_TILEMAP_WIDTH + tx;
+                stale_tiles[i / 8] |= 1 << (i % 8);
+            }
         }
     }
 }
 
-gfx_vec2_t gfx_world_to_screen(const gfx_vec2_t vec) {
-    const int16_t x = (vec.x - vec.y) * GFX_TILEMP_TILE_HALF_WIDTH;
-    const int16_t y = (vec.x + vec.y) * GFX_TILEMP_TILE_HALF_HEIGHT;
+void gfx_invalidate_sprite(gfx_sprite_t *sprite) {
+    // overlapping sprites are composited into the same rect, so they don't need to be invalidated
+    sprite->flags |= GFX_DIRTY_BIT;
+    gfx_damage_push(gfx_sprite_rect(sprite));
+}
 
-    return (gfx_vec2_t){
-        .x = (short)(x + tft.width()),
-        .y = (short)(y + tft.height() / 4)};
+gfx_rect_t gfx_sprite_rect(const gfx_sprite_t *sprite) {
+    return (gfx_rect_t){
+        .x = (int16_t)(sprite->position.x - (sprite->size.x / 2)),
+        .y = sprite->position.y,
+        .width = sprite->size.x,
+        .height = sprite->size.y};
 }
 
-gfx_vec2_t gfx_screen_to_world(const gfx_vec2_t vec) {
-    const float centered_x = vec.x - (tft.width());
-    const float centered_y = vec.y - (tft.height() / 4.0f);
+// Gets the first world row in view
+static int16_t gfx_view_top() {
+    return active_scene != NULL && active_scene->tilemap != NULL ? active_scene->tilemap->top : 0;
+}
 
-    const float fx = (centered_x / GFX_TILEMP_TILE_HALF_WIDTH + centered_y / GFX_TILEMP_TILE_HALF_HEIGHT) * 0.5f;
-    const float fy = (centered_y / GFX_TILEMP_TILE_HALF_HEIGHT - centered_x / GFX_TILEMP_TILE_HALF_WIDTH) * 0.5f;
+gfx_vec2_t gfx_world_to_screen(const gfx_vec2_t vec) {
+    return gfx_iso_world_to_screen(vec.x, vec.y - gfx_view_top());
+}
 
-    return (gfx_vec2_t){
-        .x = (int16_t)floorf(fx),
-        .y = (int16_t)floorf(fy)
-    };
+gfx_vec2_t gfx_screen_to_world(const gfx_vec2_t vec) {
+    gfx_vec2_t world = gfx_iso_screen_to_world(vec.x, vec.y);
+    world.y += gfx_view_top();
+    return world;
 }
 
 void gfx_begin_batch(uint16_t x, uint16_t y, uint16_t width, uint16_t height) {
@@ -430,7 +1368,60 @@ void gfx_end_batch() {
 }
 
 void gfx_push_pixel(uint16_t colour) {
-    tft.pushColor(colour);
+    // the batch already holds the transaction, pushColor would start a new one for every pixel
+    tft.SPI_WRITE16(colour);
+}
+
+void gfx_fill_rect(int16_t x, int16_t y, int16_t width, int16_t height, uint16_t colour) {
+    // a single address window and a tight loop of the same colour instead of a call per pixel
+    tft.startWrite();
+    tft.writeFillRect(x, y, width, height, colour);
+    tft.endWrite();
+}
+
+#ifdef GFX_CONFIG_BENCHMARK
+/*
+Fills the screen twice, once per pixel through pushColor (the old path) and once through gfx_write_span,
+and reports both times and the pixel throughput over UART.
+*/
+void gfx_benchmark() {
+    uint8_t line[PIXELS_PER_READ * 2];
+    for (uint8_t i = 0; i < sizeof(line); i++) {
+        line[i] = (i & 1) ? 0x1F : 0xF8;
+    }
+
+    const uint32_t pixels = (uint32_t)tft.width() * tft.height();
+
+    uint32_t start = scheduler_millis();
+    for (int16_t y = 0; y < tft.height(); y++) {
+        tft.startWrite();
+        tft.setAddrWindow(0, y, tft.width(), 1);
+        for (int16_t x = 0; x < tft.width(); x++) {
+            tft.pushColor(0xF81F);
+        }
+        tft.endWrite();
+    }
+    const uint32_t push_ms = scheduler_millis() - start;
+
+    start = scheduler_millis();
+    for (int16_t y = 0; y < tft.height(); y++) {
+        for (int16_t x = 0; x < tft.width(); x += PIXELS_PER_READ) {
+            tft.startWrite();
+            tft.setAddrWindow(x, y, PIXELS_PER_READ, 1);
+            gfx_write_span(line, PIXELS_PER_READ);
+            tft.endWrite();
+        }
+    }
+    const uint32_t span_ms = scheduler_millis() - start;
+
+    char msg[64];
+    snprintf(msg, sizeof(msg), "push: %lums %lupx/s\nspan: %lums %lupx/s\n",
+             push_ms, pixels * 1000 / max(push_ms, 1UL),
+             span_ms, pixels * 1000 / max(span_ms, 1UL));
+    sendUartData(msg, strlen(msg));
+
+    gfx_reset();
 }
+#endif // GFX_CONFIG_BENCHMARK
 
 
@@ -5,6 +5,18 @@
 #ifndef ATMEGA_GAME_GFX_H
 #define ATMEGA_GAME_GFX_H
 
+#ifndef GFX_CONFIG_ASSET_PACK
+#define GFX_CONFIG_ASSET_PACK "P"
+#endif // GFX_CONFIG_ASSET_PACK
+
+#ifndef GFX_SCREEN_WIDTH
+#define GFX_SCREEN_WIDTH 240
+#endif // GFX_SCREEN_WIDTH
+
+#ifndef GFX_SCREEN_HEIGHT
+#define GFX_SCREEN_HEIGHT 320
+#endif // GFX_SCREEN_HEIGHT
+
 #ifndef GFX_CONFIG_BACKGROUND_COLOUR
 #define GFX_CONFIG_BACKGROUND_COLOUR 0x0000
 #endif // GFX_CONFIG_BACKGROUND_COLOUR
@@ -13,6 +25,11 @@
 #define GFX_SCENE_MAX_SPRITES 4
 #endif // GFX_SCENE_MAX_SPRITES
 
+// Tilemaps stacked over the ground tilemap of a scene (traps, decals, etc)
+#ifndef GFX_SCENE_MAX_OVERLAYS
+#define GFX_SCENE_MAX_OVERLAYS 2
+#endif // GFX_SCENE_MAX_OVERLAYS
+
 #ifndef GFX_TILEMAP_MAX_KINDS
 #define GFX_TILEMAP_MAX_KINDS 8
 #endif // GFX_TILEMAP_MAX_KINDS
@@ -21,6 +38,49 @@
 #define GFX_TILEMAP_MAX_DIRTY_PER_FRAME 8
 #endif // GFX_TILEMAP_MAX_KINDS
 
+#ifndef GFX_COMPOSITOR_CELL_WIDTH
+#define GFX_COMPOSITOR_CELL_WIDTH 32
+#endif // GFX_COMPOSITOR_CELL_WIDTH
+
+#ifndef GFX_COMPOSITOR_CELL_HEIGHT
+#define GFX_COMPOSITOR_CELL_HEIGHT 8
+#endif // GFX_COMPOSITOR_CELL_HEIGHT
+
+#ifndef GFX_COMPOSITOR_MAX_DRAWABLES
+#define GFX_COMPOSITOR_MAX_DRAWABLES 16
+#endif // GFX_COMPOSITOR_MAX_DRAWABLES
+
+// Pixels the damage compositor may draw in a single frame, the rest of the damage is drawn in the next frame
+#ifndef GFX_FRAME_PIXEL_BUDGET
+#define GFX_FRAME_PIXEL_BUDGET 16384
+#endif // GFX_FRAME_PIXEL_BUDGET
+
+// Drawables the damage compositor may read from the SD card in a single frame, the rest of the damage is drawn in the
+// next frame. A full redraw reads every tile once, so damage never costs more card reads than a redraw
+#ifndef GFX_FRAME_READ_BUDGET
+#define GFX_FRAME_READ_BUDGET (GFX_TILEMAP_WIDTH * GFX_TILEMAP_HEIGHT)
+#endif // GFX_FRAME_READ_BUDGET
+
+// Lines at the top of the screen that stay in place during a scrolling transition (e.g. a HUD strip)
+#ifndef GFX_SCROLL_TOP_FIXED
+#define GFX_SCROLL_TOP_FIXED 0
+#endif // GFX_SCROLL_TOP_FIXED
+
+// Lines a scrolling transition advances every frame
+#ifndef GFX_SCROLL_STEP
+#define GFX_SCROLL_STEP 16
+#endif // GFX_SCROLL_STEP
+
+#define GFX_SCROLL_AREA (GFX_SCREEN_HEIGHT - GFX_SCROLL_TOP_FIXED)
+
+#ifndef GFX_PALETTE_CACHE_COLOURS
+#define GFX_PALETTE_CACHE_COLOURS 64
+#endif // GFX_PALETTE_CACHE_COLOURS
+
+#ifndef GFX_PALETTE_CACHE_SLOTS
+#define GFX_PALETTE_CACHE_SLOTS 4
+#endif // GFX_PALETTE_CACHE_SLOTS
+
 #ifndef GFX_TILEMAP_WIDTH
 #define GFX_TILEMAP_WIDTH 4
 #endif // GFX_TILEMAP_WIDTH
@@ -52,24 +112,91 @@
 #endif
 
 #define GFX_DIRTY_BIT 1
+// Overlay tiles cover the tiles below them completely, the layers below are not drawn where the overlay has a tile
+#define GFX_OPAQUE_BIT 2
 
 #include <stdint.h>
 #include <stdbool.h>
 
-// Represents a bitmap (SD Card handles)
+/*
+ * Custom file format
+ * File: the asset pack (GFX_CONFIG_ASSET_PACK on the SD card), made by misc/asset_packer.py
+ *
+ * Every gpk V3 file starts with a magic number: 0x67 0x70 0x6B 0x56 0x33, which is gpkV3 in ascii
+ * Followed by:
+ * The amount of assets in the pack (8 bit)
+ * An index entry per asset (13 bytes), all integers are little-endian:
+ *   The asset name, zero padded (4 bytes)
+ *   The width and the height in pixels (2x 16 bit)
+ *   The offset of the asset from the start of the file (32 bit)
+ *   The encoding of the asset (8 bit), one of GFX_ASSET_ENCODING_*
+ * And then the assets, every pixel a big-endian RGB565 value, which is the native format of the TFT display.
+ *
+ * Spans: the asset starts with a row table: the file offset of every row (32 bit each)
+ * Every row is the amount of opaque runs (8 bit) followed by the runs, where each run consists of:
+ *   The amount of transparent pixels to skip before the run (8 bit)
+ *   The length of the run (8 bit), zero if the run only skips
+ *   The pixels of the run
+ * Raw: the pixels of every row, without a row table. Used for fully opaque assets,
+ *   which start on a sector boundary (GFX_ASSET_SECTOR_SIZE) so they can be streamed from the card.
+ * Palette (4 or 8 bit): spans, but between the row table and the rows is the palette:
+ *   The amount of colours (8 bit), at most GFX_PALETTE_CACHE_COLOURS
+ *   The colours
+ *   The pixels of a run are palette indices, with 4 bit indices two per byte (high nibble first),
+ *   every run starting on a new byte.
+ * Fill: spans, but every run has a third byte after its length: 1 if the run is a single colour, 0 if it isn't.
+ *   A single coloured run is followed by its colour only, which is sent to the TFT without reading any pixels.
+ *
+ * Sprite sheets are ordinary assets with their frames stacked from top to bottom, the row table (or the row size
+ * of a raw asset) is the frame index: frame n starts at row n * frame height.
+*/
+#define GFX_ASSET_MAGIC "gpkV3"
+#define GFX_ASSET_MAGIC_LEN 5
+#define GFX_ASSET_NAME_LEN 4
+#define GFX_ASSET_ENTRY_SIZE 13
+#define GFX_ASSET_SECTOR_SIZE 512
+
+#define GFX_ASSET_ENCODING_SPANS 0
+#define GFX_ASSET_ENCODING_RAW 1
+#define GFX_ASSET_ENCODING_PAL4 2
+#define GFX_ASSET_ENCODING_PAL8 3
+#define GFX_ASSET_ENCODING_FILL 4
+
+// Represents a bitmap (an asset in the asset pack)
 typedef struct gfx_bitmap
 {
-    const char *filename;
-    int32_t offset;
-    int32_t row_size;
+    const char *filename; // name of the asset in the pack
+    int32_t offset; // offset of the row table
+    uint16_t width;
+    uint16_t height;
+    uint8_t encoding; // GFX_ASSET_ENCODING_*
+    uint8_t generation; // the pack the offset belongs to, 0 until the bitmap is looked up
 } gfx_bitmap_t;
 
-// Represents a tilemap (The world, traps, etc), note that every tilemap is of equal size.
+// Asset pack handle statistics, see gfx_get_pack_stats
+typedef struct gfx_pack_stats
+{
+    uint32_t hits;   // draws that reused the open pack and the looked up offset
+    uint32_t misses; // draws that had to look the bitmap up again, after a remount
+    uint8_t opens;   // times the pack was opened
+} gfx_pack_stats_t;
+
+/*
+Represents a tilemap (The world, traps, etc), note that every tilemap is of equal size.
+The tilemap is the view on a world that may be taller than the screen: it holds the GFX_TILEMAP_HEIGHT world rows
+from top onwards, as a ring buffer. World row ty is stored at row GFX_TILEMAP_RING_ROW(ty), so moving the view
+recycles the rows that leave it for the rows that come into it. Tile coordinates are world coordinates.
+*/
+
+// Row of the ring buffer that holds world row ty, rows above row 0 (negative ty) wrap around as well
+#define GFX_TILEMAP_RING_ROW(ty) ((((ty) % GFX_TILEMAP_HEIGHT) + GFX_TILEMAP_HEIGHT) % GFX_TILEMAP_HEIGHT)
+
 typedef struct gfx_tilemap
 {
     uint8_t flags;
     gfx_bitmap_t *kinds[GFX_TILEMAP_MAX_KINDS];
     uint8_t tiles[GFX_TILEMAP_WIDTH * GFX_TILEMAP_HEIGHT];
+    int16_t top; // first world row in view
 } gfx_tilemap_t;
 
 // Represents a 2D vector
@@ -95,14 +222,25 @@ typedef struct gfx_sprite
     gfx_vec2_t position;
     gfx_vec2_t size;
     gfx_bitmap_t *bitmap;
+    uint8_t layer; // orders sprites standing on the same diagonal, higher layers are drawn in front
+    int16_t depth; // tx + ty of the tile the sprite stands on, kept up to date by the renderer
+    uint8_t frame; // frame of a sprite sheet, see gfx_set_frame_sprite
 } gfx_sprite_t;
 
-// Represents the scene
+/*
+Represents the scene
+The overlays are drawn over the ground tilemap, in order, and are in the same view (see gfx_set_viewport).
+Kinds without a bitmap (NULL) are empty, so the tiles below show through; kind 0 is usually left empty.
+Changing an overlay tile keeps the ground tile below it, only that tile's area is composited again.
+Where an overlay with GFX_OPAQUE_BIT has a tile, the layers below it are not read at all.
+*/
 typedef struct gfx_scene
 {
-    gfx_tilemap_t *tilemap;
-    gfx_sprite_t *sprites[GFX_SCENE_MAX_SPRITES];
+    gfx_tilemap_t *tilemap; // the ground
+    gfx_sprite_t *sprites[GFX_SCENE_MAX_SPRITES]; // from back to front (depth, then layer)
     uint8_t sprite_count;
+    gfx_tilemap_t *overlays[GFX_SCENE_MAX_OVERLAYS];
+    uint8_t overlay_count;
 } gfx_scene_t;
 
 // Initializes the graphics framework
@@ -114,43 +252,73 @@ GFX_EXTERN_C void gfx_frame();
 // Resets the currently active scene
 GFX_EXTERN_C void gfx_reset();
 
-// Loads metadata for a bitmap from the SD card
+// Re-initializes the SD card (e.g. after it was swapped), bitmaps are looked up again on their next draw
+GFX_EXTERN_C bool gfx_remount();
+
+// Looks up a bitmap in the asset pack, returns 0 on success
 GFX_EXTERN_C int gfx_init_bitmap(gfx_bitmap_t *bitmap);
 
+// Gets the hit and miss counters of the asset pack handle
+GFX_EXTERN_C gfx_pack_stats_t gfx_get_pack_stats();
+
 // Adds a sprite to the active scene
 GFX_EXTERN_C bool gfx_add_sprite(gfx_sprite_t *sprite);
 
 // Removes a sprite from the active scene
 GFX_EXTERN_C void gfx_remove_sprite(gfx_sprite_t *sprite);
 
-// Moves a sprite to the given position (and invalidates it)
+// Moves a sprite to the given position (and invalidates it), the sprite is drawn in the depth of its new tile
 GFX_EXTERN_C void gfx_move_sprite(gfx_sprite_t *sprite, int16_t x, int16_t y);
 
 // Sets the bitmap of the sprite (and invalidates it)
 GFX_EXTERN_C void gfx_set_bitmap_sprite(gfx_sprite_t* sprite, gfx_bitmap_t* bitmap);
 
+// Shows another frame of the sprite's sheet, the sprite is only invalidated if the frame changed.
+// A sheet is a bitmap with its frames (size.y rows each) stacked from top to bottom
+GFX_EXTERN_C void gfx_set_frame_sprite(gfx_sprite_t *sprite, uint8_t frame);
+
 // Changes and invalidates a certain tile
 GFX_EXTERN_C void gfx_set_tile(gfx_tilemap_t *map, int16_t tx, int16_t ty, uint8_t kind);
 
-// Get the current tile
+// Get the current tile, 0 if the tile is not in view
 GFX_EXTERN_C uint8_t gfx_get_tile(gfx_tilemap_t *map, int16_t tx, int16_t ty);
 
+// Gets the GFX_TILEMAP_WIDTH tiles of a world row, NULL if the row is not in view
+GFX_EXTERN_C uint8_t *gfx_tilemap_row(gfx_tilemap_t *map, int16_t ty);
+
+// Moves the view to start at another world row, only the screen positions that show another tile than before are
+// drawn again. The rows that come into view keep the tiles of the rows they replace until they are filled
+// (see gfx_tilemap_row), invalidate their tiles once they are.
+// Sprites are placed in screen coordinates, so they have to be moved again
+GFX_EXTERN_C void gfx_set_viewport(gfx_tilemap_t *map, int16_t top);
+
 // Sets the active tilemap of the active scene
 GFX_EXTERN_C void gfx_set_tilemap(gfx_tilemap_t *map);
 
 // Sets the current active scene
 GFX_EXTERN_C void gfx_set_scene(gfx_scene_t *scene);
 
-// Assumes the tilemap as dirty
+// Assumes the tilemap (the ground or an overlay) as dirty, which redraws the whole scene
 GFX_EXTERN_C void gfx_invalidate_tilemap(gfx_tilemap_t *map);
 
+// Scrolls the screen out at the top while the next frames draw the scene in from the bottom.
+// Use after changing the tilemap instead of invalidating it, a full redraw ends the transition
+GFX_EXTERN_C void gfx_scroll_transition();
+
+// Whether a scrolling transition is running
+GFX_EXTERN_C bool gfx_scrolling();
+
+// Ends a running scrolling transition at once and puts the screen back in place, the lines that didn't scroll in yet
+// are left as they are. Use before drawing straight to the TFT, which would otherwise land in shifted lines
+GFX_EXTERN_C void gfx_scroll_stop();
+
 // Assumes a single tile as dirty, must be done if you changed that tile
 GFX_EXTERN_C void gfx_invalidate_tile(gfx_tilemap_t *map, int16_t tx, int16_t ty);
 
 // Assumes a sprite as dirty
 GFX_EXTERN_C void gfx_invalidate_sprite(gfx_sprite_t *sprite);
 
-// Unsafely pushes a dirty-rect to the graphics driver
+// Pushes a dirty-rect to the graphics driver, see damage.h
 GFX_EXTERN_C void gfx_push_dirty_rect(int16_t x, int16_t y, int16_t width, int16_t height);
 
 // Partially updates a single tile (internals)
@@ -159,6 +327,9 @@ GFX_EXTERN_C void gfx_draw_tile(gfx_vec2_t position, gfx_bitmap_t *bitmap, gfx_r
 // Fully updates a sprite
 GFX_EXTERN_C void gfx_draw_sprite(gfx_sprite_t *sprite);
 
+// Gets the screen area covered by a sprite
+GFX_EXTERN_C gfx_rect_t gfx_sprite_rect(const gfx_sprite_t *sprite);
+
 // Transform a world to screen coordinate
 GFX_EXTERN_C gfx_vec2_t gfx_world_to_screen(gfx_vec2_t vec);
 
@@ -174,8 +345,16 @@ GFX_EXTERN_C void gfx_end_batch();
 // Set pixel
 GFX_EXTERN_C void gfx_push_pixel(uint16_t colour);
 
+// Fills a rect with a single colour, clipped to the screen
+GFX_EXTERN_C void gfx_fill_rect(int16_t x, int16_t y, int16_t width, int16_t height, uint16_t colour);
+
+#ifdef GFX_CONFIG_BENCHMARK
+// Measures the pixel throughput of the per-pixel and the span blit path, prints the result over UART
+GFX_EXTERN_C void gfx_benchmark();
+#endif // GFX_CONFIG_BENCHMARK
+
 #ifndef GFX_FULLSCREEN
-#define GFX_FULLSCREEN ((gfx_rect_t){0, 0, 240, 320})
+#define GFX_FULLSCREEN ((gfx_rect_t){0, 0, GFX_SCREEN_WIDTH, GFX_SCREEN_HEIGHT})
 #endif
 
 #endif // ATMEGA_GAME_GFX_H
\ No newline at end of file
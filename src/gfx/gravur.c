@@ -1,53 +1,148 @@
 #include "gravur.h"
 #include <stdint.h>
-#include <stdlib.h>
-
-static const uint8_t font[10][5] = {
-    {0b111, 0b101, 0b101, 0b101, 0b111}, // 0
-    {0b010, 0b110, 0b010, 0b010, 0b111}, // 1
-    {0b111, 0b001, 0b111, 0b100, 0b111}, // 2
-    {0b111, 0b001, 0b111, 0b001, 0b111}, // 3
-    {0b101, 0b101, 0b111, 0b001, 0b001}, // 4
-    {0b111, 0b100, 0b111, 0b001, 0b111}, // 5
-    {0b111, 0b100, 0b111, 0b101, 0b111}, // 6
-    {0b111, 0b001, 0b001, 0b001, 0b001}, // 7
-    {0b111, 0b101, 0b111, 0b101, 0b111}, // 8
-    {0b111, 0b101, 0b111, 0b001, 0b111}, // 9
+#include <avr/pgmspace.h>
+
+// A glyph is 5 rows of 3 bits (the left column in the highest bit), the first row in the highest bits
+#define GLYPH(r0, r1, r2, r3, r4) (uint16_t)(((r0) << 12) | ((r1) << 9) | ((r2) << 6) | ((r3) << 3) | (r4))
+
+#define FONT_DIGITS 0
+#define FONT_LETTERS 10
+#define FONT_COLON 36
+#define FONT_MINUS 37
+#define FONT_PERIOD 38
+
+static const uint16_t font[] PROGMEM = {
+    GLYPH(0b111, 0b101, 0b101, 0b101, 0b111), // 0
+    GLYPH(0b010, 0b110, 0b010, 0b010, 0b111), // 1
+    GLYPH(0b111, 0b001, 0b111, 0b100, 0b111), // 2
+    GLYPH(0b111, 0b001, 0b111, 0b001, 0b111), // 3
+    GLYPH(0b101, 0b101, 0b111, 0b001, 0b001), // 4
+    GLYPH(0b111, 0b100, 0b111, 0b001, 0b111), // 5
+    GLYPH(0b111, 0b100, 0b111, 0b101, 0b111), // 6
+    GLYPH(0b111, 0b001, 0b001, 0b001, 0b001), // 7
+    GLYPH(0b111, 0b101, 0b111, 0b101, 0b111), // 8
+    GLYPH(0b111, 0b101, 0b111, 0b001, 0b111), // 9
+    GLYPH(0b010, 0b101, 0b111, 0b101, 0b101), // A
+    GLYPH(0b110, 0b101, 0b110, 0b101, 0b110), // B
+    GLYPH(0b011, 0b100, 0b100, 0b100, 0b011), // C
+    GLYPH(0b110, 0b101, 0b101, 0b101, 0b110), // D
+    GLYPH(0b111, 0b100, 0b110, 0b100, 0b111), // E
+    GLYPH(0b111, 0b100, 0b110, 0b100, 0b100), // F
+    GLYPH(0b011, 0b100, 0b101, 0b101, 0b011), // G
+    GLYPH(0b101, 0b101, 0b111, 0b101, 0b101), // H
+    GLYPH(0b111, 0b010, 0b010, 0b010, 0b111), // I
+    GLYPH(0b001, 0b001, 0b001, 0b101, 0b010), // J
+    GLYPH(0b101, 0b101, 0b110, 0b101, 0b101), // K
+    GLYPH(0b100, 0b100, 0b100, 0b100, 0b111), // L
+    GLYPH(0b101, 0b111, 0b111, 0b101, 0b101), // M
+    GLYPH(0b110, 0b101, 0b101, 0b101, 0b101), // N
+    GLYPH(0b010, 0b101, 0b101, 0b101, 0b010), // O
+    GLYPH(0b110, 0b101, 0b110, 0b100, 0b100), // P
+    GLYPH(0b010, 0b101, 0b101, 0b110, 0b011), // Q
+    GLYPH(0b110, 0b101, 0b110, 0b101, 0b101), // R
+    GLYPH(0b011, 0b100, 0b010, 0b001, 0b110), // S
+    GLYPH(0b111, 0b010, 0b010, 0b010, 0b010), // T
+    GLYPH(0b101, 0b101, 0b101, 0b101, 0b111), // U
+    GLYPH(0b101, 0b101, 0b101, 0b101, 0b010), // V
+    GLYPH(0b101, 0b101, 0b111, 0b111, 0b101), // W
+    GLYPH(0b101, 0b101, 0b010, 0b101, 0b101), // X
+    GLYPH(0b101, 0b101, 0b010, 0b010, 0b010), // Y
+    GLYPH(0b111, 0b001, 0b010, 0b100, 0b111), // Z
+    GLYPH(0b000, 0b010, 0b000, 0b010, 0b000), // :
+    GLYPH(0b000, 0b000, 0b111, 0b000, 0b000), // -
+    GLYPH(0b000, 0b000, 0b000, 0b000, 0b010), // .
 };
 
-void gravur_write_integer(uint16_t x, uint16_t y, uint16_t scale, bool mirrored, int num) {
-    char buffer[10];
-    itoa(num, buffer, 10);
+static uint16_t gravur_glyph(char c) {
+    if (c >= 'a' && c <= 'z') {
+        c = (char)(c - 'a' + 'A');
+    }
+
+    uint8_t index;
+    if (c >= '0' && c <= '9') {
+        index = FONT_DIGITS + (c - '0');
+    } else if (c >= 'A' && c <= 'Z') {
+        index = FONT_LETTERS + (c - 'A');
+    } else if (c == ':') {
+        index = FONT_COLON;
+    } else if (c == '-') {
+        index = FONT_MINUS;
+    } else if (c == '.') {
+        index = FONT_PERIOD;
+    } else {
+        return 0;
+    }
 
-    uint16_t cursor_x = x;
+    return pgm_read_word(&font[index]);
+}
 
-    for (char* p = buffer; *p != '\0'; p++) {
-        char c = *p;
-        if (c < '0' || c > '9') {
+static uint8_t gravur_row(uint16_t glyph, uint8_t row, bool mirrored) {
+    if (mirrored) {
+        row = GRAVUR_GLYPH_HEIGHT - 1 - row;
+    }
+    return (glyph >> ((GRAVUR_GLYPH_HEIGHT - 1 - row) * GRAVUR_GLYPH_WIDTH)) & ((1 << GRAVUR_GLYPH_WIDTH) - 1);
+}
+
+// Fills every horizontal run of set bits as a single rect
+static void gravur_fill_runs(uint16_t x, uint16_t y, uint16_t scale, uint16_t height, uint8_t bits, uint16_t colour) {
+    uint8_t col = 0;
+
+    while (col < GRAVUR_GLYPH_WIDTH) {
+        if (!(bits & (1 << (GRAVUR_GLYPH_WIDTH - 1 - col)))) {
+            col++;
             continue;
         }
 
-        uint8_t digit = c - '0';
-
-        gfx_begin_batch(cursor_x, y, 3 * scale, 5 * scale);
-        for (uint8_t row = 0; row < 5; row++) {
-            uint8_t actual_row = mirrored ? (4 - row) : row;
-            for (uint8_t sy = 0; sy < scale; sy++) {
-                for (uint8_t col = 0; col < 3; col++) {
-                    uint16_t color;
-                    if (font[digit][actual_row] & (1 << (2 - col))) {
-                        color = 0xFFFF;
-                    } else {
-                        color = 0x0000;
-                    }
-                    for (uint8_t sx = 0; sx < scale; sx++) {
-                        gfx_push_pixel(color);
-                    }
-                }
-            }
+        const uint8_t start = col;
+        while (col < GRAVUR_GLYPH_WIDTH && bits & (1 << (GRAVUR_GLYPH_WIDTH - 1 - col))) {
+            col++;
         }
-        gfx_end_batch();
 
-        cursor_x += (3 + 1) * scale;
+        gfx_fill_rect(x + start * scale, y, (col - start) * scale, height, colour);
     }
-}
\ No newline at end of file
+}
+
+void gravur_write_glyph(uint16_t x, uint16_t y, uint16_t scale, bool mirrored, bool transparent, char c) {
+    const uint16_t glyph = gravur_glyph(c);
+    const uint8_t mask = (1 << GRAVUR_GLYPH_WIDTH) - 1;
+    uint8_t row = 0;
+
+    while (row < GRAVUR_GLYPH_HEIGHT) {
+        // equal rows below each other are filled together, so the sides of a 0 are a single rect each
+        const uint8_t bits = gravur_row(glyph, row, mirrored);
+        uint8_t rows = 1;
+        while (row + rows < GRAVUR_GLYPH_HEIGHT && gravur_row(glyph, row + rows, mirrored) == bits) {
+            rows++;
+        }
+
+        const uint16_t top = y + row * scale;
+        gravur_fill_runs(x, top, scale, rows * scale, bits, GRAVUR_COLOUR);
+        if (!transparent) {
+            gravur_fill_runs(x, top, scale, rows * scale, ~bits & mask, GRAVUR_BACKGROUND_COLOUR);
+        }
+
+        row += rows;
+    }
+}
+
+void gravur_write_text(uint16_t x, uint16_t y, uint16_t scale, bool mirrored, bool transparent, const char *text) {
+    for (; *text != '\0'; text++) {
+        gravur_write_glyph(x, y, scale, mirrored, transparent, *text);
+        x += GRAVUR_GLYPH_ADVANCE * scale;
+    }
+}
+
+void gravur_write_integer(uint16_t x, uint16_t y, uint16_t scale, bool mirrored, bool transparent, int num) {
+    // digits from the back, the sign is not drawn
+    char buffer[12];
+    char* p = buffer + sizeof(buffer) - 1;
+    unsigned int value = num < 0 ? -(unsigned int)num : (unsigned int)num;
+
+    *p = '\0';
+    do {
+        *--p = (char)('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+
+    gravur_write_text(x, y, scale, mirrored, transparent, p);
+}
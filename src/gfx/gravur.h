@@ -5,12 +5,33 @@
 
 #include "gfx.h"
 
+// Size of a glyph in font pixels, multiplied by the scale on screen
+#define GRAVUR_GLYPH_WIDTH 3
+#define GRAVUR_GLYPH_HEIGHT 5
+// Horizontal distance between two glyphs, including the spacing
+#define GRAVUR_GLYPH_ADVANCE 4
+
+#ifndef GRAVUR_COLOUR
+#define GRAVUR_COLOUR 0xFFFF
+#endif // GRAVUR_COLOUR
+
+#ifndef GRAVUR_BACKGROUND_COLOUR
+#define GRAVUR_BACKGROUND_COLOUR 0x0000
+#endif // GRAVUR_BACKGROUND_COLOUR
+
 typedef struct gravur {
     gfx_bitmap_t** chars;
     uint8_t char_offset; // used for numerical fonts
     uint8_t size;
 } gravur_t;
 
-void gravur_write_integer(uint16_t x, uint16_t y, uint16_t scale, bool mirrored, int num);
+// Draws a single glyph (digits, letters, ':', '-' and '.'), unknown characters are blank.
+// Opaque glyphs fill the whole cell so they replace whatever was there, transparent glyphs only draw their lit pixels
+GFX_EXTERN_C void gravur_write_glyph(uint16_t x, uint16_t y, uint16_t scale, bool mirrored, bool transparent, char c);
+
+// Draws a string of glyphs from left to right
+GFX_EXTERN_C void gravur_write_text(uint16_t x, uint16_t y, uint16_t scale, bool mirrored, bool transparent, const char *text);
+
+GFX_EXTERN_C void gravur_write_integer(uint16_t x, uint16_t y, uint16_t scale, bool mirrored, bool transparent, int num);
 
 #endif //ATMEGA_GAME_GRAVUR_H
\ No newline at end of file
@@ -0,0 +1,135 @@
+#include "hud.h"
+
+#include <string.h>
+
+#include "gravur.h"
+
+static gfx_hud_widget_t *widgets[GFX_HUD_MAX_WIDGETS];
+static uint8_t widget_count;
+
+// Gets the amount of glyphs of a widget, limited to what fits in its text
+static uint8_t gfx_hud_length(const gfx_hud_widget_t *widget) {
+    return widget->length < GFX_HUD_MAX_GLYPHS ? widget->length : GFX_HUD_MAX_GLYPHS;
+}
+
+void gfx_hud_reset() {
+    widget_count = 0;
+}
+
+bool gfx_hud_add(gfx_hud_widget_t *widget) {
+    if (widget_count >= GFX_HUD_MAX_WIDGETS) {
+        return false;
+    }
+
+    for (uint8_t i = 0; i < widget_count; i++) {
+        if (widgets[i] == widget) {
+            return true;
+        }
+    }
+
+    widget->flags |= GFX_DIRTY_BIT;
+    widgets[widget_count++] = widget;
+    return true;
+}
+
+void gfx_hud_remove(gfx_hud_widget_t *widget) {
+    for (uint8_t i = 0; i < widget_count; i++) {
+        if (widgets[i] != widget) {
+            continue;
+        }
+
+        widgets[i] = widgets[--widget_count];
+
+        // the widget covered the scene, let the renderer draw what is below it
+        const gfx_rect_t rect = gfx_hud_rect(widget);
+        gfx_push_dirty_rect(rect.x, rect.y, rect.width, rect.height);
+        return;
+    }
+}
+
+gfx_rect_t gfx_hud_rect(const gfx_hud_widget_t *widget) {
+    return (gfx_rect_t){
+        .x = widget->x,
+        .y = widget->y,
+        .width = (int16_t)(((gfx_hud_length(widget) - 1) * GRAVUR_GLYPH_ADVANCE + GRAVUR_GLYPH_WIDTH) * widget->scale),
+        .height = (int16_t)(GRAVUR_GLYPH_HEIGHT * widget->scale)};
+}
+
+uint8_t gfx_hud_count() {
+    return widget_count;
+}
+
+const gfx_hud_widget_t *gfx_hud_get(const uint8_t index) {
+    return widgets[index];
+}
+
+void gfx_hud_set_label(gfx_hud_widget_t *widget, const char *label) {
+    const uint8_t length = gfx_hud_length(widget);
+    strncpy(widget->text, label, length);
+    widget->text[length] = '\0';
+}
+
+void gfx_hud_set_number(gfx_hud_widget_t *widget, int32_t number) {
+    char buffer[12];
+    char *p = buffer + sizeof(buffer) - 1;
+    const bool negative = number < 0;
+    uint32_t value = negative ? -(uint32_t)number : (uint32_t)number;
+
+    *p = '\0';
+    do {
+        *--p = (char)('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+
+    if (negative) {
+        *--p = '-';
+    }
+
+    gfx_hud_set_label(widget, p);
+}
+
+void gfx_hud_set_timer(gfx_hud_widget_t *widget, uint32_t millis) {
+    const uint32_t seconds = millis / 1000;
+    // the timer stops at 9:59, there is only one digit for the minutes
+    const uint32_t minutes = seconds / 60 < 9 ? seconds / 60 : 9;
+    const uint8_t rest = seconds / 60 < 10 ? seconds % 60 : 59;
+
+    const char text[5] = {
+        (char)('0' + minutes),
+        ':',
+        (char)('0' + rest / 10),
+        (char)('0' + rest % 10),
+        '\0'
+    };
+
+    gfx_hud_set_label(widget, text);
+}
+
+static void gfx_hud_draw(gfx_hud_widget_t *widget, const bool everything) {
+    bool ended = false;
+
+    for (uint8_t i = 0; i < gfx_hud_length(widget); i++) {
+        // glyphs past the end of the text are blank, so a shorter text clears the old one
+        ended = ended || widget->text[i] == '\0';
+        const char c = ended ? ' ' : widget->text[i];
+
+        if (!everything && widget->shown[i] == c) {
+            continue;
+        }
+
+        gravur_write_glyph(widget->x + i * GRAVUR_GLYPH_ADVANCE * widget->scale, widget->y, widget->scale, false, false, c);
+        widget->shown[i] = c;
+    }
+
+    widget->flags &= ~GFX_DIRTY_BIT;
+}
+
+void gfx_hud_frame(bool redrawn) {
+    for (uint8_t i = 0; i < widget_count; i++) {
+        gfx_hud_widget_t *widget = widgets[i];
+
+        // a full redraw has drawn over the widget, the compositor never does
+        const bool everything = redrawn || (widget->flags & GFX_DIRTY_BIT) != 0;
+        gfx_hud_draw(widget, everything);
+    }
+}
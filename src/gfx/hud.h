@@ -0,0 +1,65 @@
+#ifndef ATMEGA_GAME_HUD_H
+#define ATMEGA_GAME_HUD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "gfx.h"
+
+#ifndef GFX_HUD_MAX_WIDGETS
+#define GFX_HUD_MAX_WIDGETS 4
+#endif // GFX_HUD_MAX_WIDGETS
+
+// Most glyphs a widget can show
+#ifndef GFX_HUD_MAX_GLYPHS
+#define GFX_HUD_MAX_GLYPHS 6
+#endif // GFX_HUD_MAX_GLYPHS
+
+/*
+A piece of text on top of the scene (the score, a label, a timer).
+A widget owns the screen area of its glyphs and is drawn opaque, on its own, after the scene.
+The compositor leaves that area alone, so the scene never draws over a widget (only a full redraw does).
+It remembers what is on screen and only redraws the glyphs that changed.
+*/
+typedef struct gfx_hud_widget
+{
+    uint8_t flags; // GFX_DIRTY_BIT: every glyph has to be redrawn
+    int16_t x;
+    int16_t y;
+    uint8_t scale;
+    uint8_t length;                       // glyphs reserved on screen, at most GFX_HUD_MAX_GLYPHS
+    char text[GFX_HUD_MAX_GLYPHS + 1];    // text to show
+    char shown[GFX_HUD_MAX_GLYPHS + 1];   // text on screen
+} gfx_hud_widget_t;
+
+// Removes all widgets
+GFX_EXTERN_C void gfx_hud_reset();
+
+// Shows a widget, the widget must stay alive until it is removed
+GFX_EXTERN_C bool gfx_hud_add(gfx_hud_widget_t *widget);
+
+// Hides a widget, the scene below it is redrawn
+GFX_EXTERN_C void gfx_hud_remove(gfx_hud_widget_t *widget);
+
+// Gets the screen area reserved by a widget
+GFX_EXTERN_C gfx_rect_t gfx_hud_rect(const gfx_hud_widget_t *widget);
+
+// Amount of widgets shown
+GFX_EXTERN_C uint8_t gfx_hud_count();
+
+// Gets a shown widget
+GFX_EXTERN_C const gfx_hud_widget_t *gfx_hud_get(uint8_t index);
+
+// Shows a number
+GFX_EXTERN_C void gfx_hud_set_number(gfx_hud_widget_t *widget, int32_t number);
+
+// Shows a label, text beyond the length of the widget is cut off
+GFX_EXTERN_C void gfx_hud_set_label(gfx_hud_widget_t *widget, const char *label);
+
+// Shows a time as minutes and seconds (m:ss)
+GFX_EXTERN_C void gfx_hud_set_timer(gfx_hud_widget_t *widget, uint32_t millis);
+
+// Draws the glyphs that changed, or every glyph when the whole screen was redrawn this frame (called by gfx_frame)
+GFX_EXTERN_C void gfx_hud_frame(bool redrawn);
+
+#endif //ATMEGA_GAME_HUD_H
@@ -0,0 +1,47 @@
+#ifndef ATMEGA_GAME_ISO_H
+#define ATMEGA_GAME_ISO_H
+
+#include <stdint.h>
+
+#include "gfx.h"
+
+// Screen position of the top corner of tile (0, 0)
+#define GFX_ISO_ORIGIN_X GFX_SCREEN_WIDTH
+#define GFX_ISO_ORIGIN_Y (GFX_SCREEN_HEIGHT / 4)
+
+// Screen position of the top corner of a tile, a constant expression when the tile is constant.
+// The half tile sizes are powers of two, so for variable tiles this is a shift and an add (no table needed)
+#define GFX_ISO_TILE_X(tx, ty) (GFX_ISO_ORIGIN_X + ((tx) - (ty)) * GFX_TILEMP_TILE_HALF_WIDTH)
+#define GFX_ISO_TILE_Y(tx, ty) (GFX_ISO_ORIGIN_Y + ((tx) + (ty)) * GFX_TILEMP_TILE_HALF_HEIGHT)
+
+// Screen position of the top-left corner of the bounding box of a tile
+#define GFX_ISO_TILE_LEFT(tx, ty) (GFX_ISO_TILE_X(tx, ty) - GFX_TILEMP_TILE_HALF_WIDTH)
+#define GFX_ISO_TILE_TOP(tx, ty) GFX_ISO_TILE_Y(tx, ty)
+
+// Divisor of the inverse transform: a screen pixel is (x / half width + y / half height) / 2 tiles away,
+// which is (x * half height + y * half width) / (2 * half width * half height) without fractions
+#define GFX_ISO_INVERSE_DIVISOR (2L * GFX_TILEMP_TILE_HALF_WIDTH * GFX_TILEMP_TILE_HALF_HEIGHT)
+
+// Division rounding towards negative infinity, the divisor must be positive
+static inline int16_t gfx_iso_floor_div(const int32_t n, const int32_t d) {
+    return (int16_t)(n >= 0 ? n / d : -((d - 1 - n) / d));
+}
+
+// Transform a world to screen coordinate, the top corner of the tile
+static inline gfx_vec2_t gfx_iso_world_to_screen(const int16_t tx, const int16_t ty) {
+    return (gfx_vec2_t){
+        .x = (int16_t)GFX_ISO_TILE_X(tx, ty),
+        .y = (int16_t)GFX_ISO_TILE_Y(tx, ty)};
+}
+
+// Transform a screen to world coordinate, exact: gives the tile whose diamond contains the pixel
+static inline gfx_vec2_t gfx_iso_screen_to_world(const int16_t x, const int16_t y) {
+    const int32_t cx = (int32_t)(x - GFX_ISO_ORIGIN_X) * GFX_TILEMP_TILE_HALF_HEIGHT;
+    const int32_t cy = (int32_t)(y - GFX_ISO_ORIGIN_Y) * GFX_TILEMP_TILE_HALF_WIDTH;
+
+    return (gfx_vec2_t){
+        .x = gfx_iso_floor_div(cy + cx, GFX_ISO_INVERSE_DIVISOR),
+        .y = gfx_iso_floor_div(cy - cx, GFX_ISO_INVERSE_DIVISOR)};
+}
+
+#endif //ATMEGA_GAME_ISO_H
@@ -0,0 +1,80 @@
+#include "pacer.h"
+
+static uint32_t due_ms;
+static uint32_t start_ms;
+
+static uint16_t histogram[GFX_PACER_BUCKETS];
+static uint16_t frames;
+static uint16_t min_ms = UINT16_MAX;
+static uint16_t max_ms;
+static uint32_t total_ms;
+
+bool gfx_pacer_due(const uint32_t now) {
+    // the difference wraps along with the timer
+    if ((int32_t)(now - due_ms) < 0) {
+        return false;
+    }
+
+    // a frame that ran late pushes the next one back instead of starting a burst of frames to catch up
+    due_ms += GFX_PACER_FRAME_MS;
+    if ((int32_t)(now - due_ms) >= 0) {
+        due_ms = now + GFX_PACER_FRAME_MS;
+    }
+
+    start_ms = now;
+    return true;
+}
+
+void gfx_pacer_end(const uint32_t now) {
+    const uint32_t elapsed = now - start_ms;
+    const uint16_t ms = elapsed < UINT16_MAX ? (uint16_t)elapsed : UINT16_MAX;
+    const uint16_t bucket = ms / GFX_PACER_BUCKET_MS;
+
+    // the statistics stop at the counter limit rather than wrap
+    if (frames == UINT16_MAX) {
+        return;
+    }
+
+    frames++;
+    total_ms += ms;
+    min_ms = ms < min_ms ? ms : min_ms;
+    max_ms = ms > max_ms ? ms : max_ms;
+    histogram[bucket < GFX_PACER_BUCKETS ? bucket : GFX_PACER_BUCKETS - 1]++;
+}
+
+gfx_pacer_stats_t gfx_pacer_get_stats() {
+    gfx_pacer_stats_t stats = { 0 };
+    if (frames == 0) {
+        return stats;
+    }
+
+    stats.frames = frames;
+    stats.min_ms = min_ms;
+    stats.avg_ms = (uint16_t)(total_ms / frames);
+    stats.max_ms = max_ms;
+
+    // the first bucket where at least 99% of the frames are done
+    const uint32_t target = ((uint32_t)frames * 99 + 99) / 100;
+    uint32_t seen = 0;
+    for (uint8_t i = 0; i < GFX_PACER_BUCKETS; i++) {
+        seen += histogram[i];
+        if (seen >= target) {
+            stats.p99_ms = i == GFX_PACER_BUCKETS - 1 ? max_ms : (uint16_t)((i + 1) * GFX_PACER_BUCKET_MS);
+            break;
+        }
+    }
+
+    // a bucket's upper bound can exceed the slowest frame in it
+    stats.p99_ms = stats.p99_ms < max_ms ? stats.p99_ms : max_ms;
+    return stats;
+}
+
+void gfx_pacer_reset_stats() {
+    for (uint8_t i = 0; i < GFX_PACER_BUCKETS; i++) {
+        histogram[i] = 0;
+    }
+    frames = 0;
+    min_ms = UINT16_MAX;
+    max_ms = 0;
+    total_ms = 0;
+}
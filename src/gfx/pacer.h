@@ -0,0 +1,45 @@
+#ifndef ATMEGA_GAME_PACER_H
+#define ATMEGA_GAME_PACER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "gfx.h"
+
+// Time between the starts of two frames, the main loop polls input and loads sound in between
+#ifndef GFX_PACER_FRAME_MS
+#define GFX_PACER_FRAME_MS 40
+#endif // GFX_PACER_FRAME_MS
+
+// Frame times are counted in a histogram for the 99th percentile, the last bucket holds every slower frame
+#ifndef GFX_PACER_BUCKET_MS
+#define GFX_PACER_BUCKET_MS 4
+#endif // GFX_PACER_BUCKET_MS
+
+#ifndef GFX_PACER_BUCKETS
+#define GFX_PACER_BUCKETS 32
+#endif // GFX_PACER_BUCKETS
+
+// Frame time statistics since the last reset, in milliseconds
+typedef struct gfx_pacer_stats
+{
+    uint16_t frames;
+    uint16_t min_ms;
+    uint16_t avg_ms;
+    uint16_t max_ms;
+    uint16_t p99_ms; // upper bound of the histogram bucket the 99th percentile falls in
+} gfx_pacer_stats_t;
+
+// Whether the next frame is due at the given time (scheduler_millis), if so the frame starts now
+GFX_EXTERN_C bool gfx_pacer_due(uint32_t now);
+
+// Ends the frame started by gfx_pacer_due and records how long it took
+GFX_EXTERN_C void gfx_pacer_end(uint32_t now);
+
+// Gets the frame time statistics
+GFX_EXTERN_C gfx_pacer_stats_t gfx_pacer_get_stats();
+
+// Clears the frame time statistics
+GFX_EXTERN_C void gfx_pacer_reset_stats();
+
+#endif //ATMEGA_GAME_PACER_H
@@ -23,7 +23,10 @@
 #include "net/proto.h"
 #include "resources.h"
 #include "game/npc.h"
-#include "gfx/gravur.h"
+#include "gfx/hud.h"
+#include "gfx/anim.h"
+#include "gfx/pacer.h"
+#include "gfx/damage.h"
 #include <avr/wdt.h>
 
 #include "../lib/eeprom/eeprom.h"
@@ -35,11 +38,14 @@
 s_Sound main_theme;
 volatile uint8_t adc_value = 0;
 static gfx_scene_t game_scene;
+static gfx_hud_widget_t score_hud = {
+    .x = 8,
+    .y = 8,
+    .scale = 4,
+    .length = 5,
+};
 static game_npc_t player_npc = {
-    .tex_north = { .filename = PLAYER_BOTTOM_RIGHT },
-    .tex_east = { .filename = PLAYER_TOP_LEFT  },
-    .tex_south = { .filename = PLAYER_TOP_RIGHT },
-    .tex_west = { .filename = PLAYER_BOTTOM_LEFT },
+    .sheet = { .filename = PLAYER_SHEET },
     .sprite = {
         .position = { 0, 0 },
         .size = { GFX_TILEMAP_TILE_WIDTH, GFX_TILEMAP_TILE_HEIGHT },
@@ -93,16 +99,25 @@ void start(void)
     startAdc();
     initTone();
     gfx_init();
+#ifdef GFX_CONFIG_BENCHMARK
+    gfx_benchmark();
+#endif
+#if defined(SOUND_CONFIG_SYNTH) && defined(SYNTH_CONFIG_BENCHMARK)
+    synth_benchmark();
+#endif
     world_init();
 
     show_fullscreen(HOMESCREEN);
 
     game_scene.tilemap = world_get_tilemap();
     game_scene.sprite_count = 0;
+    game_scene.overlays[0] = world_get_trap_tilemap();
+    game_scene.overlay_count = 1;
 
     gfx_set_scene(&game_scene);
 
     init_player();
+    cache_sound_effect(HOP);
     play_sound(TETRIS, 0);
 
     proto_init();
@@ -114,9 +129,21 @@ void game_init() {
         gfx_add_sprite(&(player_npc.sprite));
     }
 
+    // only the runner scores
+    gfx_hud_remove(&score_hud);
+    if (player_get_role() == RUNNER) {
+        gfx_hud_set_number(&score_hud, player_get_score());
+        gfx_hud_add(&score_hud);
+    }
+
     traps_size = 0;
-    world_next_level();
+
+    // the home or game over screen is still showing, the first level scrolls in over it instead of a full redraw
+    world_scroll_next_level();
     move_npc(&player_npc, 0, 500, 500);
+
+    // frame times are reported per game
+    gfx_pacer_reset_stats();
 }
 
 uint8_t get_active_variant(uint8_t kind) {
@@ -138,7 +165,8 @@ uint8_t get_inactive_variant(uint8_t kind) {
 }
 
 void activate_trap(gfx_vec2_t world_pos) {
-    gfx_tilemap_t* tilemap = world_get_tilemap();
+    // traps are an overlay, the ground below them stays as it is
+    gfx_tilemap_t* tilemap = world_get_trap_tilemap();
     uint8_t current_tile = gfx_get_tile(tilemap, world_pos.x, world_pos.y);
     uint8_t desired_tile = get_active_variant(current_tile);
 
@@ -174,7 +202,7 @@ void update_traps() {
     for (uint8_t i = 0; i < traps_size; i++)
     {
         trap_state_t* trap = &traps[i];
-        gfx_tilemap_t* tilemap = world_get_tilemap();
+        gfx_tilemap_t* tilemap = world_get_trap_tilemap();
         uint8_t current_tile = gfx_get_tile(tilemap, trap->tx, trap->ty);
 
         if (now >= trap->deactive_at) {
@@ -213,6 +241,11 @@ void game_update_net() {
             }
 
             case CMD_MOVE: {
+                // the view follows the runner here as well, the selector moves along with it
+                if (world_follow(p.data[2])) {
+                    player_update_sprite();
+                }
+
                 gfx_vec2_t player_screen_pos = gfx_world_to_screen((gfx_vec2_t){ (int16_t)(p.data[1]), (int16_t)(p.data[2]) });
                 move_npc(&player_npc, p.data[0], player_screen_pos.x, player_screen_pos.y);
                 break;
@@ -225,6 +258,34 @@ void game_update_net() {
                 break;
             }
 
+            case CMD_FRAME_STATS: {
+                // milliseconds don't fit in a byte for very slow frames, those are reported as 255
+                const gfx_pacer_stats_t stats = gfx_pacer_get_stats();
+                const uint16_t times[4] = { stats.min_ms, stats.avg_ms, stats.max_ms, stats.p99_ms };
+
+                uint8_t data[4];
+                for (uint8_t i = 0; i < 4; i++) {
+                    data[i] = times[i] < UINT8_MAX ? (uint8_t)times[i] : UINT8_MAX;
+                }
+                proto_emit(CMD_FRAME_STATS_REPLY, data);
+                break;
+            }
+
+            case CMD_DAMAGE_STATS: {
+                // below 100% merging saved overdraw, above it the merged boxes cover more than what was pushed
+                const gfx_damage_stats_t stats = gfx_damage_get_stats();
+                const uint32_t percent = stats.pushed_area > 0 ? stats.drawn_area * 100 / stats.pushed_area : 0;
+
+                uint8_t data[4] = {
+                    stats.pushed,
+                    stats.drawn,
+                    percent < UINT8_MAX ? (uint8_t)percent : UINT8_MAX,
+                    stats.overflowed
+                };
+                proto_emit(CMD_DAMAGE_STATS_REPLY, data);
+                break;
+            }
+
             case CMD_GAME_OVER: {
                 if (player_get_role() == DEATH) {
                     gfx_remove_sprite(&(player_npc.sprite));
@@ -278,7 +339,7 @@ void game_update() {
                 gfx_vec2_t pos = player_get_world_position();
                 uint8_t overflow_y = pos.x + 8;
 
-                gravur_write_integer(8, 8, 4, false, player_get_score());
+                gfx_hud_set_number(&score_hud, player_get_score());
 
                 if (pos.y == overflow_y) {
                     uint8_t data[4] = { 0 };
@@ -311,9 +372,16 @@ void loop(void) {
         update_traps();
 
         // cli();
-        if (get_game_state() == GAME_RUNNING) // hack, but in certain situations the state may have been changed.
+        // frames are paced, so a burst of damage can't keep the loop from polling input and loading sound
+        if (get_game_state() == GAME_RUNNING && gfx_pacer_due(scheduler_millis())) // hack, but in certain situations the state may have been changed.
         {
+            // the runner looks around on the death player's screen while it stands still
+            if (player_get_role() == DEATH) {
+                update_npc(&player_npc, scheduler_millis());
+            }
+            gfx_anim_tick(scheduler_millis());
             gfx_frame();
+            gfx_pacer_end(scheduler_millis());
         }
         // sei();
     }
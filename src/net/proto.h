@@ -23,6 +23,10 @@
 #define CMD_ACTIVATE_TRAP 0x08 // Activate trap (2x uint8_t)
 #define CMD_NEXT_SCENE    0x09 // Move to next scene (no data)
 #define CMD_GAME_OVER     0x0A // Game over (1x uint16_t)
+#define CMD_FRAME_STATS   0x0B // Frame time statistics request (no data)
+#define CMD_FRAME_STATS_REPLY 0x0C // Frame time statistics: min, avg, max and p99 in ms (4x uint8_t)
+#define CMD_DAMAGE_STATS  0x0D // Damage statistics request of the last frame (no data)
+#define CMD_DAMAGE_STATS_REPLY 0x0E // Damage statistics: rects pushed, rects drawn, drawn area in % of the pushed area and overflowed (4x uint8_t)
 
 typedef struct proto_packet {
     uint8_t opcode;
@@ -13,6 +13,8 @@
 #define PLAYER_BOTTOM_RIGHT     "1"
 #define PLAYER_TOP_LEFT         "2"
 #define PLAYER_TOP_RIGHT        "3"
+// the four frames above as one sprite sheet, in the same order (asset_packer.py N=0.bmp,1.bmp,2.bmp,3.bmp)
+#define PLAYER_SHEET            "N"
 
 #define WATER_TILE "A"
 #define GRASS_TILE "B"
@@ -28,6 +30,7 @@
 
 #define HOP "Y"
 #define TETRIS "Z"
+#define ZELDA "X"
 
 
 #endif //ATMEGA_GAME_RESOURCES_H
\ No newline at end of file
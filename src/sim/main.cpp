@@ -0,0 +1,212 @@
+/*
+Host-native render simulator, built by the native PlatformIO environment (pio run -e native).
+Plays a fixed scene through the real renderer, prints what every frame cost and optionally dumps every frame as PNG:
+
+    .pio/build/native/program <sd card directory> [frame output directory]
+
+The sd card directory holds the asset pack (GFX_CONFIG_ASSET_PACK), made with misc/asset_packer.py.
+*/
+#include <stdio.h>
+
+#include "sim.h"
+#include "gfx/gfx.h"
+#include "gfx/hud.h"
+#include "gfx/gravur.h"
+#include "gfx/anim.h"
+#include "gfx/damage.h"
+#include "resources.h"
+
+#define SIM_HOPS 11
+// simulated time between two hops
+#define SIM_HOP_MS 250
+// rows the view moves down after the scroll transition
+#define SIM_VIEWPORT_STEPS 3
+
+static gfx_bitmap_t grass = { GRASS_TILE };
+static gfx_bitmap_t water = { WATER_TILE };
+static gfx_bitmap_t spike_closed = { SPIKE_CLOSED };
+static gfx_bitmap_t stone = { STONE_TILE };
+static gfx_bitmap_t spike_open = { SPIKE_OPEN };
+static gfx_bitmap_t player_bitmap = { PLAYER_BOTTOM_LEFT };
+static gfx_bitmap_t selector_bitmap = { SELECTOR };
+static gfx_bitmap_t homescreen = { HOMESCREEN };
+
+// same kinds as the world map, see world_generation/world.c
+static gfx_tilemap_t tilemap = {
+    GFX_DIRTY_BIT,
+    { &grass, &water, &spike_closed, &stone, &spike_open },
+    { 0 }
+};
+
+// the trap overlay over it
+static gfx_tilemap_t traps = {
+    GFX_DIRTY_BIT | GFX_OPAQUE_BIT,
+    { NULL, NULL, &spike_closed, NULL, &spike_open },
+    { 0 }
+};
+
+static gfx_scene_t scene;
+static gfx_sprite_t player = { 0, { 0, 0 }, { GFX_TILEMAP_TILE_WIDTH, GFX_TILEMAP_TILE_HEIGHT }, &player_bitmap };
+static gfx_sprite_t selector = { 0, { 0, 0 }, { GFX_TILEMAP_TILE_WIDTH, GFX_TILEMAP_TILE_HEIGHT }, &selector_bitmap };
+
+static gfx_bitmap_t npc_sheet = { PLAYER_SHEET };
+static gfx_sprite_t npc = { 0, { 0, 0 }, { GFX_TILEMAP_TILE_WIDTH, GFX_TILEMAP_TILE_HEIGHT }, &npc_sheet };
+static const uint8_t npc_frames[] = { 0, 1, 2, 3 };
+static const gfx_animation_t npc_spin = { npc_frames, sizeof(npc_frames), 400, true };
+static gfx_anim_player_t npc_animation = { &npc };
+
+static gfx_hud_widget_t score = { 0, 8, 8, 4, 5, { 0 }, { 0 } };
+static gfx_hud_widget_t timer = { 0, 180, 8, 3, 4, { 0 }, { 0 } };
+
+static const char *output_directory;
+static uint8_t frame_number;
+
+static void sim_init_bitmap(gfx_bitmap_t *bitmap) {
+    if (gfx_init_bitmap(bitmap) != 0) {
+        fprintf(stderr, "sim: asset '%s' is not in the pack\n", bitmap->filename);
+    }
+}
+
+static void sim_place(gfx_sprite_t *sprite, const int16_t tx, const int16_t ty) {
+    const gfx_vec2_t screen = gfx_world_to_screen((gfx_vec2_t){ tx, ty });
+    gfx_move_sprite(sprite, screen.x, screen.y);
+}
+
+// Prints the counters of the frame that was just drawn and dumps it
+static void sim_end_frame(const char *name) {
+    const sim_stats_t stats = sim_take_stats();
+
+    printf("%3u %-12s %9u %8u %13u %9u %11u %9u\n", frame_number, name, stats.spi_bytes, stats.address_windows,
+           stats.transactions, stats.sd_bytes, stats.sd_sectors, stats.sd_opens);
+
+    if (output_directory != NULL) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s/frame_%03u.png", output_directory, frame_number);
+        if (!sim_write_png(path)) {
+            fprintf(stderr, "sim: can't write %s\n", path);
+        }
+    }
+
+    frame_number++;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <sd card directory> [frame output directory]\n", argv[0]);
+        return 1;
+    }
+
+    sim_sd_mount(argv[1]);
+    output_directory = argc > 2 ? argv[2] : NULL;
+
+    gfx_init();
+
+    gfx_bitmap_t *bitmaps[] = { &grass, &water, &spike_closed, &stone, &spike_open,
+                                &player_bitmap, &selector_bitmap, &homescreen, &npc_sheet };
+    for (uint8_t i = 0; i < sizeof(bitmaps) / sizeof(bitmaps[0]); i++) {
+        sim_init_bitmap(bitmaps[i]);
+    }
+
+    // a fixed level: trap rows like the world generator makes them, with some water and stone
+    for (int16_t ty = 0; ty < GFX_TILEMAP_HEIGHT; ty++) {
+        for (int16_t tx = 0; tx < GFX_TILEMAP_WIDTH; tx++) {
+            const bool trap = ty == 4 || ty == 7;
+            tilemap.tiles[ty * GFX_TILEMAP_WIDTH + tx] =
+                trap ? 0 : (tx * 7 + ty * 3) % 5 == 0 ? 1 : (tx + ty * 5) % 7 == 0 ? 3 : 0;
+            traps.tiles[ty * GFX_TILEMAP_WIDTH + tx] = trap ? 2 : 0;
+        }
+    }
+
+    scene.tilemap = &tilemap;
+    scene.overlays[0] = &traps;
+    scene.overlay_count = 1;
+    gfx_set_scene(&scene);
+    // added front to back, the renderer draws them in depth order
+    gfx_add_sprite(&selector);
+    gfx_add_sprite(&player);
+    gfx_add_sprite(&npc);
+    gfx_anim_play(&npc_animation, &npc_spin, 0);
+    gfx_hud_set_number(&score, 0);
+    gfx_hud_add(&score);
+    gfx_hud_set_timer(&timer, 0);
+    gfx_hud_add(&timer);
+
+    sim_take_stats();
+    printf("  # frame        spi bytes  windows  transactions  sd bytes  sd sectors  sd opens\n");
+
+    // full redraw
+    sim_place(&player, GFX_TILEMAP_WIDTH / 2 - 1, 0);
+    sim_place(&selector, GFX_TILEMAP_WIDTH / 2 - 1, 1);
+    sim_place(&npc, 0, 2);
+    gfx_frame();
+    sim_end_frame("redraw");
+
+    // the player hops down the map while the traps toggle
+    for (int16_t hop = 1; hop <= SIM_HOPS; hop++) {
+        sim_place(&player, GFX_TILEMAP_WIDTH / 2 - 1, hop);
+        sim_place(&selector, GFX_TILEMAP_WIDTH / 2 - 1, hop + 1);
+        gfx_hud_set_number(&score, hop * 9);
+        gfx_hud_set_timer(&timer, hop * 1700UL);
+
+        // the npc turns on its own clock, it is only redrawn when its frame changes
+        gfx_anim_tick(hop * SIM_HOP_MS);
+
+        for (int16_t tx = 0; tx < GFX_TILEMAP_WIDTH; tx++) {
+            gfx_set_tile(&traps, tx, 4, hop % 2 ? 4 : 2);
+        }
+
+        gfx_frame();
+        sim_end_frame("hop");
+    }
+
+    // damage over the frame budget (GFX_FRAME_PIXEL_BUDGET, GFX_FRAME_READ_BUDGET) was left for the following frames
+    while (gfx_damage_count() > 0) {
+        gfx_frame();
+        sim_end_frame("deferred");
+    }
+
+    // the next level scrolls in from the bottom, like world_next_level does
+    for (int16_t ty = 0; ty < GFX_TILEMAP_HEIGHT; ty++) {
+        for (int16_t tx = 0; tx < GFX_TILEMAP_WIDTH; tx++) {
+            const bool trap = ty == 4 || ty == 7;
+            tilemap.tiles[ty * GFX_TILEMAP_WIDTH + tx] = !trap && (tx * 3 + ty) % 4 == 0 ? 1 : 0;
+            traps.tiles[ty * GFX_TILEMAP_WIDTH + tx] = trap ? 2 : 0;
+        }
+    }
+    sim_place(&player, GFX_TILEMAP_WIDTH / 2 - 1, 0);
+    sim_place(&selector, GFX_TILEMAP_WIDTH / 2 - 1, 1);
+    gfx_scroll_transition();
+    while (gfx_scrolling()) {
+        gfx_frame();
+        sim_end_frame("scroll");
+    }
+
+    // the view moves down a world taller than the screen, like world_advance does: the row that leaves the view
+    // is recycled for the row that comes into it. Only that row and the tiles that look different are drawn again
+    for (int16_t step = 1; step <= SIM_VIEWPORT_STEPS; step++) {
+        gfx_set_viewport(&tilemap, tilemap.top + 1);
+        gfx_set_viewport(&traps, traps.top + 1);
+
+        const int16_t ty = tilemap.top + GFX_TILEMAP_HEIGHT - 1;
+        const bool trap = GFX_TILEMAP_RING_ROW(ty) == 4;
+        uint8_t *row = gfx_tilemap_row(&tilemap, ty);
+        uint8_t *trap_row = gfx_tilemap_row(&traps, ty);
+        for (int16_t tx = 0; tx < GFX_TILEMAP_WIDTH; tx++) {
+            row[tx] = !trap && (tx + ty) % 3 == 0 ? 3 : 0;
+            trap_row[tx] = trap ? 2 : 0;
+        }
+
+        sim_place(&player, GFX_TILEMAP_WIDTH / 2 - 1, tilemap.top);
+        sim_place(&selector, GFX_TILEMAP_WIDTH / 2 - 1, tilemap.top + 1);
+        gfx_frame();
+        sim_end_frame("viewport");
+    }
+
+    // a fullscreen image, drawn like show_fullscreen does
+    gfx_sprite_t fullscreen = { 0, { GFX_SCREEN_WIDTH / 2, 0 }, { GFX_SCREEN_WIDTH, GFX_SCREEN_HEIGHT }, &homescreen };
+    gfx_draw_sprite(&fullscreen);
+    gravur_write_text(8, 8, 2, false, true, "GAME OVER");
+    sim_end_frame("fullscreen");
+
+    return 0;
+}
@@ -0,0 +1,8 @@
+// Host stand-in for Adafruit GFX, the renderer only uses it through Adafruit_ILI9341
+
+#ifndef ATMEGA_GAME_SIM_ADAFRUIT_GFX_H
+#define ATMEGA_GAME_SIM_ADAFRUIT_GFX_H
+
+#include <Arduino.h>
+
+#endif //ATMEGA_GAME_SIM_ADAFRUIT_GFX_H
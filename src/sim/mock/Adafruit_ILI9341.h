@@ -0,0 +1,46 @@
+// Host stand-in for the ILI9341 driver, draws into the framebuffer of the simulator (see src/sim/tft.cpp)
+
+#ifndef ATMEGA_GAME_SIM_ADAFRUIT_ILI9341_H
+#define ATMEGA_GAME_SIM_ADAFRUIT_ILI9341_H
+
+#include <Adafruit_GFX.h>
+
+#define ILI9341_TFTWIDTH 240
+#define ILI9341_TFTHEIGHT 320
+
+#define ILI9341_RAMWR 0x2C
+#define ILI9341_VSCRDEF 0x33
+#define ILI9341_VSCRSADD 0x37
+
+class Adafruit_ILI9341 {
+public:
+    Adafruit_ILI9341(int8_t cs, int8_t dc, int8_t rst = -1);
+
+    void begin(uint32_t freq = 0);
+    int16_t width() const { return ILI9341_TFTWIDTH; }
+    int16_t height() const { return ILI9341_TFTHEIGHT; }
+
+    void startWrite();
+    void endWrite();
+    void setAddrWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h);
+    void writeCommand(uint8_t cmd);
+    void writePixels(uint16_t *colors, uint32_t len, bool block = true, bool bigEndian = false);
+    void SPI_WRITE16(uint16_t w);
+    void writeColor(uint16_t color, uint32_t len);
+    void writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+
+    void fillScreen(uint16_t color);
+
+    void scrollTo(uint16_t y);
+    void setScrollMargins(uint16_t top, uint16_t bottom);
+
+private:
+    // Writes a pixel at the write pointer of the address window, like the controller's frame memory
+    void writePixel(uint16_t color);
+
+    uint8_t depth;
+    int16_t window_x, window_y, window_w, window_h;
+    int16_t cursor_x, cursor_y;
+};
+
+#endif //ATMEGA_GAME_SIM_ADAFRUIT_ILI9341_H
@@ -0,0 +1,20 @@
+// Host stand-in for the parts of the Arduino core used by the renderer, see src/sim
+
+#ifndef ATMEGA_GAME_SIM_ARDUINO_H
+#define ATMEGA_GAME_SIM_ARDUINO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifndef min
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#endif
+
+#ifndef max
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#endif
+
+#endif //ATMEGA_GAME_SIM_ARDUINO_H
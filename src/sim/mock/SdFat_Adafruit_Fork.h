@@ -0,0 +1,54 @@
+// Host stand-in for SdFat, serves the files of a host directory (see src/sim/sd.cpp)
+
+#ifndef ATMEGA_GAME_SIM_SDFAT_H
+#define ATMEGA_GAME_SIM_SDFAT_H
+
+#include <Arduino.h>
+#include <stdio.h>
+
+#define SD_SCK_MHZ(mhz) ((mhz) * 1000000UL)
+
+class File32 {
+public:
+    File32() : fp(NULL) {}
+    ~File32() { close(); }
+
+    bool open(const char *path, int oflag = 0);
+    bool close();
+    bool isOpen() const { return fp != NULL; }
+    operator bool() const { return isOpen(); }
+
+    int read(void *buf, size_t count);
+    bool seek(uint32_t pos);
+    bool seekCur(int32_t offset);
+    uint32_t curPosition() const;
+    uint32_t fileSize() const;
+
+    // Every file on the simulated card is contiguous, its sectors are handed out the first time this is called
+    bool contiguousRange(uint32_t *bgnSector, uint32_t *endSector);
+
+private:
+    File32(const File32 &);
+    File32 &operator=(const File32 &);
+
+    FILE *fp;
+    char path[64];
+};
+
+class SdSpiCard {
+public:
+    bool readSector(uint32_t sector, uint8_t *dst);
+};
+
+class SdFat32 {
+public:
+    bool begin(uint8_t csPin, uint32_t maxSck);
+    uint8_t sdErrorCode() const { return 0; }
+    SdSpiCard *card() { return &spi_card; }
+    uint8_t *cacheClear();
+
+private:
+    SdSpiCard spi_card;
+};
+
+#endif //ATMEGA_GAME_SIM_SDFAT_H
@@ -0,0 +1,13 @@
+// Host stand-in for avr-libc program memory access, the host has a single address space
+
+#ifndef ATMEGA_GAME_SIM_PGMSPACE_H
+#define ATMEGA_GAME_SIM_PGMSPACE_H
+
+#include <stdint.h>
+
+#define PROGMEM
+
+#define pgm_read_byte(address) (*(const uint8_t *)(address))
+#define pgm_read_word(address) (*(const uint16_t *)(address))
+
+#endif //ATMEGA_GAME_SIM_PGMSPACE_H
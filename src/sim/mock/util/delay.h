@@ -0,0 +1,9 @@
+// Host stand-in for avr-libc's busy waits, the simulator does not model time
+
+#ifndef ATMEGA_GAME_SIM_UTIL_DELAY_H
+#define ATMEGA_GAME_SIM_UTIL_DELAY_H
+
+#define _delay_ms(ms) ((void)(ms))
+#define _delay_us(us) ((void)(us))
+
+#endif //ATMEGA_GAME_SIM_UTIL_DELAY_H
@@ -0,0 +1,178 @@
+#include <SdFat_Adafruit_Fork.h>
+
+#include "sim.h"
+
+#define SECTOR_SIZE 512
+#define MAX_CONTIGUOUS_FILES 8
+// first sector handed out to files, like a card where the data area starts after the FAT
+#define FIRST_DATA_SECTOR 8192
+
+// A file that has been given a sector range on the simulated card
+typedef struct sim_sd_extent {
+    char path[64];
+    uint32_t first_sector;
+    uint32_t sector_count;
+} sim_sd_extent_t;
+
+static char root[256];
+
+// SdFat keeps a single sector in its cache, reads within that sector don't touch the card
+static uint8_t sector_cache[SECTOR_SIZE];
+static const FILE *cached_file;
+static uint32_t cached_sector;
+
+static sim_sd_extent_t extents[MAX_CONTIGUOUS_FILES];
+static uint8_t extent_count;
+static uint32_t next_free_sector = FIRST_DATA_SECTOR;
+
+void sim_sd_mount(const char *directory) {
+    snprintf(root, sizeof(root), "%s", directory);
+    cached_file = NULL;
+    extent_count = 0;
+    next_free_sector = FIRST_DATA_SECTOR;
+}
+
+static void sim_sd_full_path(char *full, size_t size, const char *path) {
+    snprintf(full, size, "%s/%s", root, path);
+}
+
+bool File32::open(const char *path, int oflag) {
+    (void)oflag;
+    close();
+
+    char full[320];
+    sim_sd_full_path(full, sizeof(full), path);
+
+    fp = fopen(full, "rb");
+    if (fp == NULL) {
+        return false;
+    }
+
+    snprintf(this->path, sizeof(this->path), "%s", path);
+    sim_stats.sd_opens++;
+    return true;
+}
+
+bool File32::close() {
+    if (fp != NULL) {
+        if (cached_file == fp) {
+            cached_file = NULL;
+        }
+        fclose(fp);
+        fp = NULL;
+    }
+    return true;
+}
+
+int File32::read(void *buf, size_t count) {
+    if (fp == NULL) {
+        return -1;
+    }
+
+    const uint32_t pos = curPosition();
+    const size_t n = fread(buf, 1, count, fp);
+
+    sim_stats.sd_bytes += n;
+
+    // count every sector the read touches that is not in the cache
+    for (uint32_t sector = pos / SECTOR_SIZE; n > 0 && sector <= (pos + n - 1) / SECTOR_SIZE; sector++) {
+        if (cached_file != fp || cached_sector != sector) {
+            sim_stats.sd_sectors++;
+            cached_file = fp;
+            cached_sector = sector;
+        }
+    }
+
+    return (int)n;
+}
+
+bool File32::seek(uint32_t pos) {
+    return fp != NULL && fseek(fp, (long)pos, SEEK_SET) == 0;
+}
+
+bool File32::seekCur(int32_t offset) {
+    return fp != NULL && fseek(fp, offset, SEEK_CUR) == 0;
+}
+
+uint32_t File32::curPosition() const {
+    return fp != NULL ? (uint32_t)ftell(fp) : 0;
+}
+
+uint32_t File32::fileSize() const {
+    if (fp == NULL) {
+        return 0;
+    }
+
+    const long pos = ftell(fp);
+    fseek(fp, 0, SEEK_END);
+    const long size = ftell(fp);
+    fseek(fp, pos, SEEK_SET);
+    return (uint32_t)size;
+}
+
+bool File32::contiguousRange(uint32_t *bgnSector, uint32_t *endSector) {
+    if (fp == NULL) {
+        return false;
+    }
+
+    sim_sd_extent_t *extent = NULL;
+    for (uint8_t i = 0; i < extent_count; i++) {
+        if (strcmp(extents[i].path, path) == 0) {
+            extent = &extents[i];
+        }
+    }
+
+    if (extent == NULL) {
+        if (extent_count == MAX_CONTIGUOUS_FILES) {
+            return false;
+        }
+
+        extent = &extents[extent_count++];
+        snprintf(extent->path, sizeof(extent->path), "%s", path);
+        extent->first_sector = next_free_sector;
+        extent->sector_count = (fileSize() + SECTOR_SIZE - 1) / SECTOR_SIZE;
+        next_free_sector += extent->sector_count + 1;
+    }
+
+    *bgnSector = extent->first_sector;
+    *endSector = extent->first_sector + extent->sector_count - 1;
+    return true;
+}
+
+bool SdSpiCard::readSector(uint32_t sector, uint8_t *dst) {
+    for (uint8_t i = 0; i < extent_count; i++) {
+        const sim_sd_extent_t *extent = &extents[i];
+        if (sector < extent->first_sector || sector >= extent->first_sector + extent->sector_count) {
+            continue;
+        }
+
+        char full[320];
+        sim_sd_full_path(full, sizeof(full), extent->path);
+
+        FILE *f = fopen(full, "rb");
+        if (f == NULL) {
+            return false;
+        }
+
+        memset(dst, 0, SECTOR_SIZE);
+        fseek(f, (long)(sector - extent->first_sector) * SECTOR_SIZE, SEEK_SET);
+        fread(dst, 1, SECTOR_SIZE, f);
+        fclose(f);
+
+        sim_stats.sd_sectors++;
+        return true;
+    }
+
+    return false;
+}
+
+bool SdFat32::begin(uint8_t csPin, uint32_t maxSck) {
+    (void)csPin;
+    (void)maxSck;
+    return root[0] != '\0';
+}
+
+uint8_t *SdFat32::cacheClear() {
+    cached_file = NULL;
+    return sector_cache;
+}
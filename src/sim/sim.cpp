@@ -0,0 +1,132 @@
+#include <Adafruit_ILI9341.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "sim.h"
+
+// Deflate stores at most this many bytes in a single uncompressed block
+#define PNG_MAX_STORED_BLOCK 65535
+
+sim_stats_t sim_stats;
+
+sim_stats_t sim_take_stats() {
+    const sim_stats_t stats = sim_stats;
+    memset(&sim_stats, 0, sizeof(sim_stats));
+    return stats;
+}
+
+static uint32_t png_crc(uint32_t crc, const uint8_t *data, size_t length) {
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320UL & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+static void png_put_u32(uint8_t *dst, uint32_t value) {
+    dst[0] = (uint8_t)(value >> 24);
+    dst[1] = (uint8_t)(value >> 16);
+    dst[2] = (uint8_t)(value >> 8);
+    dst[3] = (uint8_t)value;
+}
+
+static void png_write_chunk(FILE *f, const char *type, const uint8_t *data, uint32_t length) {
+    uint8_t header[8];
+    png_put_u32(header, length);
+    memcpy(header + 4, type, 4);
+
+    uint8_t crc[4];
+    png_put_u32(crc, png_crc(png_crc(0, header + 4, 4), data, length));
+
+    fwrite(header, 1, sizeof(header), f);
+    if (length > 0) {
+        fwrite(data, 1, length, f);
+    }
+    fwrite(crc, 1, sizeof(crc), f);
+}
+
+/*
+Writes the frame memory as an 8 bit RGB PNG. The image data is a zlib stream of uncompressed deflate blocks,
+which keeps the simulator free of dependencies, the files are about as large as the frame memory.
+*/
+bool sim_write_png(const char *path) {
+    const uint32_t row_size = 1 + ILI9341_TFTWIDTH * 3; // filter type, then the pixels
+    const uint32_t raw_size = row_size * ILI9341_TFTHEIGHT;
+    const uint32_t block_count = (raw_size + PNG_MAX_STORED_BLOCK - 1) / PNG_MAX_STORED_BLOCK;
+    const uint32_t zlib_size = 2 + block_count * 5 + raw_size + 4;
+
+    uint8_t *raw = (uint8_t *)malloc(raw_size);
+    uint8_t *zlib = (uint8_t *)malloc(zlib_size);
+    if (raw == NULL || zlib == NULL) {
+        free(raw);
+        free(zlib);
+        return false;
+    }
+
+    // RGB565 to RGB888, repeating the high bits so white stays white
+    const uint16_t *framebuffer = sim_framebuffer();
+    for (uint32_t y = 0; y < ILI9341_TFTHEIGHT; y++) {
+        uint8_t *row = raw + y * row_size;
+        *row++ = 0;
+
+        for (uint32_t x = 0; x < ILI9341_TFTWIDTH; x++) {
+            const uint16_t colour = framebuffer[sim_display_row(y) * ILI9341_TFTWIDTH + x];
+            const uint8_t r = (colour >> 11) & 0x1F;
+            const uint8_t g = (colour >> 5) & 0x3F;
+            const uint8_t b = colour & 0x1F;
+
+            *row++ = (uint8_t)((r << 3) | (r >> 2));
+            *row++ = (uint8_t)((g << 2) | (g >> 4));
+            *row++ = (uint8_t)((b << 3) | (b >> 2));
+        }
+    }
+
+    uint8_t *out = zlib;
+    *out++ = 0x78; // deflate, 32K window
+    *out++ = 0x01; // no compression level, header checksum
+
+    uint32_t adler_a = 1, adler_b = 0;
+    for (uint32_t i = 0; i < raw_size; i++) {
+        adler_a = (adler_a + raw[i]) % 65521;
+        adler_b = (adler_b + adler_a) % 65521;
+    }
+
+    for (uint32_t offset = 0; offset < raw_size; offset += PNG_MAX_STORED_BLOCK) {
+        const uint16_t length = (uint16_t)min(raw_size - offset, (uint32_t)PNG_MAX_STORED_BLOCK);
+        *out++ = offset + length == raw_size ? 1 : 0; // last block flag, stored
+        *out++ = (uint8_t)length;
+        *out++ = (uint8_t)(length >> 8);
+        *out++ = (uint8_t)~length;
+        *out++ = (uint8_t)(~length >> 8);
+        memcpy(out, raw + offset, length);
+        out += length;
+    }
+
+    png_put_u32(out, (adler_b << 16) | adler_a);
+
+    FILE *f = fopen(path, "wb");
+    if (f != NULL) {
+        static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        uint8_t ihdr[13];
+        png_put_u32(ihdr, ILI9341_TFTWIDTH);
+        png_put_u32(ihdr + 4, ILI9341_TFTHEIGHT);
+        ihdr[8] = 8;  // bits per channel
+        ihdr[9] = 2;  // RGB
+        ihdr[10] = 0; // deflate
+        ihdr[11] = 0; // adaptive filtering
+        ihdr[12] = 0; // not interlaced
+
+        fwrite(signature, 1, sizeof(signature), f);
+        png_write_chunk(f, "IHDR", ihdr, sizeof(ihdr));
+        png_write_chunk(f, "IDAT", zlib, zlib_size);
+        png_write_chunk(f, "IEND", NULL, 0);
+        fclose(f);
+    }
+
+    free(raw);
+    free(zlib);
+    return f != NULL;
+}
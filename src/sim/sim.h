@@ -0,0 +1,36 @@
+#ifndef ATMEGA_GAME_SIM_H
+#define ATMEGA_GAME_SIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Work done by the renderer, counted by the TFT and SD stand-ins
+typedef struct sim_stats
+{
+    uint32_t spi_bytes;       // bytes clocked out to the TFT, commands and their parameters included
+    uint32_t address_windows; // setAddrWindow calls
+    uint32_t transactions;    // startWrite calls that selected the TFT
+    uint32_t sd_bytes;        // bytes read from files
+    uint32_t sd_sectors;      // sectors read from the card, into SdFat's sector cache or raw
+    uint32_t sd_opens;        // files opened
+} sim_stats_t;
+
+// Counters since the last sim_take_stats
+extern sim_stats_t sim_stats;
+
+// Serves the SD card from a host directory, must be called before gfx_init
+void sim_sd_mount(const char *directory);
+
+// Gets the counters since the last call and resets them
+sim_stats_t sim_take_stats();
+
+// Gets the frame memory of the TFT, RGB565, row by row
+const uint16_t *sim_framebuffer();
+
+// Gets the frame memory row the panel shows at a screen row, which differs while the panel is scrolled
+uint16_t sim_display_row(uint16_t y);
+
+// Writes what the panel shows as a PNG file, returns false if the file can't be written
+bool sim_write_png(const char *path);
+
+#endif //ATMEGA_GAME_SIM_H
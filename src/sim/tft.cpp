@@ -0,0 +1,178 @@
+#include <Adafruit_ILI9341.h>
+#include <stdio.h>
+
+#include "sim.h"
+
+// CASET and RASET with 4 parameter bytes each, followed by RAMWR
+#define ADDR_WINDOW_SPI_BYTES 11
+
+static uint16_t framebuffer[ILI9341_TFTWIDTH * ILI9341_TFTHEIGHT];
+
+// vertical scrolling: the fixed top lines, the scroll area and its start line (VSCRDEF and VSCRSADD)
+static uint16_t scroll_top = 0;
+static uint16_t scroll_area = ILI9341_TFTHEIGHT;
+static uint16_t scroll_start = 0;
+
+const uint16_t *sim_framebuffer() {
+    return framebuffer;
+}
+
+uint16_t sim_display_row(uint16_t y) {
+    if (y < scroll_top || y >= scroll_top + scroll_area) {
+        return y;
+    }
+
+    // the controller only accepts a start line inside the scroll area
+    const uint16_t start = scroll_start < scroll_top || scroll_start >= scroll_top + scroll_area ? scroll_top : scroll_start;
+    return scroll_top + (start - scroll_top + y - scroll_top) % scroll_area;
+}
+
+Adafruit_ILI9341::Adafruit_ILI9341(int8_t cs, int8_t dc, int8_t rst)
+    : depth(0), window_x(0), window_y(0), window_w(0), window_h(0), cursor_x(0), cursor_y(0) {
+    (void)cs;
+    (void)dc;
+    (void)rst;
+}
+
+void Adafruit_ILI9341::begin(uint32_t freq) {
+    (void)freq;
+    memset(framebuffer, 0, sizeof(framebuffer));
+    scroll_top = 0;
+    scroll_area = ILI9341_TFTHEIGHT;
+    scroll_start = 0;
+}
+
+void Adafruit_ILI9341::startWrite() {
+    if (depth++ == 0) {
+        sim_stats.transactions++;
+    }
+}
+
+void Adafruit_ILI9341::endWrite() {
+    if (depth > 0) {
+        depth--;
+    }
+}
+
+void Adafruit_ILI9341::setAddrWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h) {
+    if (depth == 0) {
+        fprintf(stderr, "sim: setAddrWindow outside of a transaction\n");
+    }
+
+    sim_stats.spi_bytes += ADDR_WINDOW_SPI_BYTES;
+    sim_stats.address_windows++;
+
+    window_x = x;
+    window_y = y;
+    window_w = w;
+    window_h = h;
+    cursor_x = 0;
+    cursor_y = 0;
+}
+
+void Adafruit_ILI9341::writeCommand(uint8_t cmd) {
+    sim_stats.spi_bytes++;
+
+    // a new memory write starts at the top-left of the window, a memory write continue (0x3C) carries on
+    if (cmd == ILI9341_RAMWR) {
+        cursor_x = 0;
+        cursor_y = 0;
+    }
+}
+
+void Adafruit_ILI9341::writePixel(uint16_t color) {
+    sim_stats.spi_bytes += 2;
+
+    if (window_w <= 0 || window_h <= 0) {
+        return;
+    }
+
+    const int16_t x = window_x + cursor_x;
+    const int16_t y = window_y + cursor_y;
+
+    if (x < ILI9341_TFTWIDTH && y < ILI9341_TFTHEIGHT) {
+        framebuffer[y * ILI9341_TFTWIDTH + x] = color;
+    }
+
+    // the write pointer wraps around within the window
+    if (++cursor_x >= window_w) {
+        cursor_x = 0;
+        if (++cursor_y >= window_h) {
+            cursor_y = 0;
+        }
+    }
+}
+
+void Adafruit_ILI9341::writePixels(uint16_t *colors, uint32_t len, bool block, bool bigEndian) {
+    (void)block;
+
+    for (uint32_t i = 0; i < len; i++) {
+        const uint8_t *bytes = (const uint8_t *)&colors[i];
+        writePixel(bigEndian ? (uint16_t)((bytes[0] << 8) | bytes[1]) : colors[i]);
+    }
+}
+
+void Adafruit_ILI9341::SPI_WRITE16(uint16_t w) {
+    writePixel(w);
+}
+
+void Adafruit_ILI9341::writeColor(uint16_t color, uint32_t len) {
+    for (uint32_t i = 0; i < len; i++) {
+        writePixel(color);
+    }
+}
+
+void Adafruit_ILI9341::writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    // clipped like Adafruit_SPITFT, nothing is sent for a rect outside of the screen
+    if (x < 0) {
+        w += x;
+        x = 0;
+    }
+    if (y < 0) {
+        h += y;
+        y = 0;
+    }
+    if (x + w > ILI9341_TFTWIDTH) {
+        w = ILI9341_TFTWIDTH - x;
+    }
+    if (y + h > ILI9341_TFTHEIGHT) {
+        h = ILI9341_TFTHEIGHT - y;
+    }
+    if (w <= 0 || h <= 0) {
+        return;
+    }
+
+    setAddrWindow(x, y, w, h);
+    writeColor(color, (uint32_t)w * h);
+}
+
+void Adafruit_ILI9341::scrollTo(uint16_t y) {
+    // its own transaction, like sendCommand
+    startWrite();
+    writeCommand(ILI9341_VSCRSADD);
+    sim_stats.spi_bytes += 2;
+    scroll_start = y;
+    endWrite();
+}
+
+void Adafruit_ILI9341::setScrollMargins(uint16_t top, uint16_t bottom) {
+    if (top + bottom > ILI9341_TFTHEIGHT) {
+        return;
+    }
+
+    startWrite();
+    writeCommand(ILI9341_VSCRDEF);
+    sim_stats.spi_bytes += 6;
+    scroll_top = top;
+    scroll_area = ILI9341_TFTHEIGHT - (top + bottom);
+    endWrite();
+}
+
+void Adafruit_ILI9341::fillScreen(uint16_t color) {
+    startWrite();
+    setAddrWindow(0, 0, ILI9341_TFTWIDTH, ILI9341_TFTHEIGHT);
+    for (uint32_t i = 0; i < (uint32_t)ILI9341_TFTWIDTH * ILI9341_TFTHEIGHT; i++) {
+        writePixel(color);
+    }
+    endWrite();
+}
@@ -8,7 +8,11 @@
 
 #include "sound.h"
 #include "tone.h"
+#include "tracks.h"
 #include <SdFat_Adafruit_Fork.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <string.h>
 
 #include "hardware/uart/uart.h"
 
@@ -16,144 +20,328 @@ s_Sound playing_sound;
 
 extern SdFat32 SD;
 
-// Global reader instance used for loading sound data from SD
+// Global reader instance used for loading sound data from SD, open for as long as a sound plays
 static File32 fileReader;
 
+static s_SoundEffect effect_cache[SFX_CACHE_SIZE];
+static uint8_t effect_cache_count;
+
+// The effect that has the tone, NULL while the music has it. Only changed with interrupts off or by the interrupt
+static const s_SoundEffect *volatile playing_effect;
+static uint8_t effect_note_index;
+static e_SfxPriority effect_priority;
+
 static void update_sound_playback();
 
-// internal function: Load up to 5 notes into the buffer
-static bool load_note_chunk() {
-    playing_sound.reader.buffer_index = 0;
-    playing_sound.reader.buffer_count = 0;
+// internal function: Whether a sound effect has taken the tone from the music, only when they share a channel
+static bool music_preempted() {
+    return TONE_SFX_CHANNEL == TONE_MUSIC_CHANNEL && playing_effect != NULL;
+}
 
-    if (fileReader.isBusy()) {
+// internal function: Read from a sound (flash or SD) at the reader position, which is advanced
+static bool read_sound(s_SoundReader *reader, File32 *file, void *dst, uint8_t size) {
+    if (reader->flash != NULL) {
+        memcpy_P(dst, reader->flash + reader->file_reader_pos, size);
+    } else if (!file->isOpen() || file->read(dst, size) != size) {
         return false;
     }
 
-    if (!fileReader.open(playing_sound.reader.filename, O_RDONLY)) {
+    reader->file_reader_pos += size;
+    return true;
+}
+
+// internal function: Move the reader position, the file follows it
+static void seek_sound(s_SoundReader *reader, File32 *file, uint32_t pos) {
+    reader->file_reader_pos = pos;
+
+    if (reader->flash == NULL) {
+        file->seekSet(pos);
+    }
+}
+
+// internal function: Find a sound that was compiled into flash
+static const uint8_t *find_flash_track(const char *filename) {
+    for (uint8_t i = 0; i < flash_track_count; i++) {
+        if (strcmp(flash_tracks[i].name, filename) == 0) {
+            return flash_tracks[i].data;
+        }
+    }
+
+    return NULL;
+}
+
+// internal function: Open a sound and read its header, the reader is left at the first note
+static bool open_sound(s_SoundReader *reader, File32 *file, const char *filename, bool *looping) {
+    reader->filename = filename;
+    reader->flash = find_flash_track(filename);
+    reader->file_reader_pos = 0;
+    reader->first_note_pos = 0;
+    reader->note_count = 0;
+    reader->reader_note_index = 0;
+
+    // Open file, unless the sound is in flash
+    if (reader->flash == NULL) {
+        if (!SD.exists(filename)) {
+            return false;
+        }
+
+        if (!file->open(filename, O_RDONLY)) {
+            return false;
+        }
+    }
+
+    // Read magic number
+    char magic[SFD_MAGIC_LEN];
+    if (!read_sound(reader, file, magic, SFD_MAGIC_LEN)) {
         return false;
     }
 
-    fileReader.seekSet(playing_sound.reader.file_reader_pos);
+    // Read looping (8-bit)
+    uint8_t looping_flag;
+    if (!read_sound(reader, file, &looping_flag, 1)) {
+        return false;
+    }
+    *looping = (looping_flag != 0);
 
-    // Read up to NOTE_CHUNK_SIZE notes
-    for (uint8_t i = 0; i < NOTE_CHUNK_SIZE; i++) {
-        if (playing_sound.reader.reader_note_index >= playing_sound.reader.note_count) {
-            break;
+    // Read note count (32-bit)
+    if (!read_sound(reader, file, &reader->note_count, sizeof(uint32_t))) {
+        return false;
+    }
+
+    reader->first_note_pos = reader->file_reader_pos;
+    return true;
+}
+
+// internal function: Load up to NOTE_CHUNK_SIZE notes into the back chunk, a looping sound continues at its start
+static bool load_note_chunk() {
+    s_SoundReader *reader = &playing_sound.reader;
+    const uint8_t back = reader->front ^ 1;
+    uint8_t count = 0;
+
+    if (reader->flash == NULL && !fileReader.isOpen()) {
+        return false;
+    }
+
+    // The file stays open, so this is a read at the cached position. No directory lookup, no cluster chain walk
+    seek_sound(reader, &fileReader, reader->file_reader_pos);
+
+    while (count < NOTE_CHUNK_SIZE) {
+        if (reader->reader_note_index >= reader->note_count) {
+            if (!playing_sound.looping || reader->note_count == 0) {
+                break;
+            }
+
+            // Start over without reopening the file
+            reader->reader_note_index = 0;
+            seek_sound(reader, &fileReader, reader->first_note_pos);
         }
 
         s_Note note;
-        if (fileReader.read(&note, sizeof(s_Note)) != sizeof(s_Note)) {
+        if (!read_sound(reader, &fileReader, &note, sizeof(s_Note))) {
             break;
         }
 
-        playing_sound.reader.note_buffer[i] = note;
-        playing_sound.reader.reader_note_index++;
-        playing_sound.reader.buffer_count++;
+        // The division happens here in the main loop, the interrupt only writes the timer registers
+        reader->note_buffer[back][count].timer = resolveTone(note.frequency + playing_sound.frequency_offset);
+        reader->note_buffer[back][count].duration = note.duration;
+
+        reader->reader_note_index++;
+        count++;
     }
 
-    playing_sound.reader.file_reader_pos = fileReader.curPosition();
-    fileReader.close();
-    return playing_sound.reader.buffer_count > 0;
+    reader->buffer_count[back] = count;
+
+    // Both flags change at once: an interrupt seeing at_end without back_ready would stop before the last chunk
+    const uint8_t sreg = SREG;
+    cli();
+    reader->at_end = !playing_sound.looping && reader->reader_note_index >= reader->note_count;
+    reader->back_ready = count > 0;
+    SREG = sreg;
+    return count > 0;
 }
 
 void play_sound(const char *filename, uint16_t frequncy_offset) {
+    // Detach the previous sound from the timer before its reader is reset
+    stop_sound_playback();
+
     playing_sound.frequency_offset = frequncy_offset;
     playing_sound.looping = false;
 
-    playing_sound.reader.filename = filename;
-    playing_sound.reader.file_reader_pos = 0;
-    playing_sound.reader.note_count = 0;
-    playing_sound.reader.reader_note_index = 0;
-    playing_sound.reader.buffer_count = 0;
+    playing_sound.reader.buffer_count[0] = 0;
+    playing_sound.reader.buffer_count[1] = 0;
+    playing_sound.reader.front = 0;
     playing_sound.reader.buffer_index = 0;
-    playing_sound.reader.needs_loading = false;
+    playing_sound.reader.back_ready = false;
+    playing_sound.reader.at_end = false;
 
-    // Open file
-    if (!SD.exists(filename)) {
-        return;
-    }
-
-    if (!fileReader.open(filename, O_RDONLY)) {
+    if (!open_sound(&playing_sound.reader, &fileReader, filename, &playing_sound.looping)) {
+        fileReader.close();
         return;
     }
 
-    // Read magic number
-    char magic[SFD_MAGIC_LEN];
-    if (fileReader.read(magic, SFD_MAGIC_LEN) != SFD_MAGIC_LEN) {
+    // Preload the first chunk, it becomes the front chunk as soon as playback starts
+    if (!load_note_chunk()) {
         fileReader.close();
         return;
     }
 
-    // Read looping (8-bit)
-    uint8_t looping_flag;
-    if (fileReader.read(&looping_flag, 1) != 1) {
-        fileReader.close();
-        return;
+    // Kickoff sound playback, or let a sound effect that took the tone start it when it ends
+    const uint8_t sreg = SREG;
+    cli();
+    playing_sound.playing = true;
+    if (!music_preempted()) {
+        playTone(0, 1, update_sound_playback);
     }
-    playing_sound.looping = (looping_flag != 0);
+    SREG = sreg;
+}
 
-    // Read note count (32-bit)
-    if (fileReader.read(&playing_sound.reader.note_count, sizeof(uint32_t)) != sizeof(uint32_t)) {
-        fileReader.close();
-        return;
+void stop_sound_playback(void) {
+    // Play tone of 0 hz and remove sound callbacks, a sound effect that took the tone keeps it but won't hand it back
+    const uint8_t sreg = SREG;
+    cli();
+    playing_sound.playing = false;
+    if (!music_preempted()) {
+        playTone(0, 0, nullptr);
     }
+    SREG = sreg;
 
-    playing_sound.reader.file_reader_pos = fileReader.curPosition();
     fileReader.close();
+    playing_sound.reader.flash = NULL;
+}
+
+bool cache_sound_effect(const char *filename) {
+    for (uint8_t i = 0; i < effect_cache_count; i++) {
+        if (strcmp(effect_cache[i].filename, filename) == 0) {
+            return true;
+        }
+    }
+
+    if (effect_cache_count >= SFX_CACHE_SIZE) {
+        return false;
+    }
+
+    // Its own reader and file, the music may be playing from the SD card
+    s_SoundReader reader;
+    File32 file;
+    bool looping;
+    s_SoundEffect *effect = &effect_cache[effect_cache_count];
+    uint8_t count = 0;
+
+    if (open_sound(&reader, &file, filename, &looping)) {
+        while (count < SFX_MAX_NOTES && reader.reader_note_index < reader.note_count) {
+            s_Note note;
+            if (!read_sound(&reader, &file, &note, sizeof(s_Note))) {
+                break;
+            }
+
+            effect->notes[count].timer = resolveTone(note.frequency);
+            effect->notes[count].duration = note.duration;
+
+            reader.reader_note_index++;
+            count++;
+        }
+    }
+
+    file.close();
 
-    // Preload first chunk
-    load_note_chunk();
+    if (count == 0) {
+        return false;
+    }
 
-    // Kickoff sound playback
-    playTone(0, 1, update_sound_playback);
+    effect->filename = filename;
+    effect->note_count = count;
+    effect_cache_count++;
+    return true;
 }
 
-void stop_sound_playback(void) {
-    // Play tone of 0 hz and remove sound callbacks
-    playTone(0, 0, nullptr);
+// Plays the next note of the sound effect, and hands the tone back to the music when the effect is done
+static void update_effect_playback() {
+    if (effect_note_index >= playing_effect->note_count) {
+        const bool preempted = music_preempted();
+        playing_effect = NULL;
+
+        // The music reader was left alone, so the music continues with the next note from its buffers
+        if (preempted && playing_sound.playing) {
+            update_sound_playback();
+        } else {
+            playToneOn(TONE_SFX_CHANNEL, 0, 0, nullptr);
+        }
+        return;
+    }
+
+    const s_LoadedNote *note = &playing_effect->notes[effect_note_index];
+    effect_note_index++;
+
+    playResolvedToneOn(TONE_SFX_CHANNEL, note->timer, note->duration, update_effect_playback);
+}
+
+bool play_sound_effect(const char *filename, e_SfxPriority priority) {
+    const s_SoundEffect *effect = NULL;
+    for (uint8_t i = 0; i < effect_cache_count; i++) {
+        if (effect_cache[i].filename == filename || strcmp(effect_cache[i].filename, filename) == 0) {
+            effect = &effect_cache[i];
+            break;
+        }
+    }
+
+    if (effect == NULL) {
+        return false;
+    }
+
+    // The interrupt mustn't end the playing effect, or play a music note while the tone is taken over
+    const uint8_t sreg = SREG;
+    cli();
+
+    if (playing_effect != NULL && priority < effect_priority) {
+        SREG = sreg;
+        return false;
+    }
+
+    playing_effect = effect;
+    effect_priority = priority;
+    effect_note_index = 0;
+
+    // Starts the first note now instead of at the end of the note that is playing
+    update_effect_playback();
+
+    SREG = sreg;
+    return true;
 }
 
 static void update_sound_playback() {
     s_SoundReader *reader = &playing_sound.reader;
 
-    // Check if we need to load more notes BEFORE accessing the buffer
-    if (reader->buffer_index >= reader->buffer_count) {
-        if (reader->reader_note_index >= reader->note_count && !playing_sound.looping) {
-            playTone(0, 0, nullptr);
+    // Front chunk is done, continue with the back chunk if the main loop has loaded it
+    if (reader->buffer_index >= reader->buffer_count[reader->front]) {
+        if (!reader->back_ready) {
+            if (reader->at_end) {
+                playing_sound.playing = false;
+                playTone(0, 0, nullptr);
+                return;
+            }
+
+            // The main loop is late, wait for it
+            playTone(0, 10, update_sound_playback);
             return;
         }
-        reader->needs_loading = true;
-        playTone(0, 10, update_sound_playback);
-        return;
+
+        reader->front ^= 1;
+        reader->buffer_index = 0;
+        reader->back_ready = false;
     }
 
     // Access note at current index (guaranteed to be valid at this point)
-    s_Note *note = &reader->note_buffer[reader->buffer_index];
+    s_LoadedNote *note = &reader->note_buffer[reader->front][reader->buffer_index];
     reader->buffer_index++;
 
-    uint16_t freq = note->frequency + playing_sound.frequency_offset;
-    playTone(freq, note->duration, update_sound_playback);
+    playResolvedTone(note->timer, note->duration, update_sound_playback);
 }
 
-// Poll function to check if sound needs chunk reloading
+// Poll function, loads the next chunk as soon as the interrupt has started playing the previous one
 void update_sound_chunks() {
     s_SoundReader *reader = &playing_sound.reader;
 
-    if (reader->needs_loading) {
-        if (!load_note_chunk()) {
-            // Distinguish between read fault or end of song
-            if (reader->reader_note_index >= reader->note_count) {
-                // End of song
-                if (playing_sound.looping) {
-                    // Restart playing sound, this will go pretty deep in the call stack and may become a problem in the future.
-                    // Tough looping sounds are not used in the game itself, so it will probably be fine
-                    play_sound(playing_sound.reader.filename, playing_sound.frequency_offset);
-                }
-            }
-        }
-        else {
-            reader->needs_loading = false;
-        }
+    if (!reader->back_ready && !reader->at_end) {
+        load_note_chunk();
     }
-}
\ No newline at end of file
+}
@@ -17,6 +17,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "tone.h"
 
 /*
  * Custom file format
@@ -30,8 +31,11 @@
  * The first being the frequency, and the second the duration of the frequency in ms
 */
 
-// How many notes to read per chunk (reduce to save RAM)
+// How many notes to read per chunk (reduce to save RAM), there are two chunks: one playing, one being loaded
 #define NOTE_CHUNK_SIZE 3
+// Sound effects are cached in RAM, this many of them with at most SFX_MAX_NOTES notes each (longer ones are cut off)
+#define SFX_CACHE_SIZE 2
+#define SFX_MAX_NOTES 8
 #define SFD_MAGIC "sfdV1"
 #define SFD_MAGIC_LEN 5
 
@@ -40,31 +44,75 @@ typedef struct {
     uint16_t duration;
 } s_Note;
 
+// A note as it is buffered for playback, its frequency is resolved to timer settings when it is loaded
+typedef struct {
+    s_ToneTimer timer;
+    uint16_t duration;
+} s_LoadedNote;
+
+/*
+ * The notes are double buffered: the timer interrupt plays the front chunk while the main loop loads the back chunk
+ * (update_sound_chunks), so the next chunk is ready before the front one runs out, even if the main loop was busy
+ * drawing for a while. The file stays open while the sound plays, loading a chunk is a read at the cached position.
+ * Sounds compiled into flash are read from there instead, they don't use the SD card at all.
+*/
 typedef struct {
     const char *filename;
+    const uint8_t *flash; // the sound compiled into flash (see tracks.h), NULL if it is read from the SD card
     uint32_t file_reader_pos;
+    uint32_t first_note_pos; // a looping sound starts over here
 
     uint32_t note_count;
     uint32_t reader_note_index;
 
-    s_Note note_buffer[NOTE_CHUNK_SIZE];
-    uint8_t buffer_count;
-    uint8_t buffer_index;
+    s_LoadedNote note_buffer[2][NOTE_CHUNK_SIZE];
+    uint8_t buffer_count[2];
+    uint8_t front;        // chunk being played
+    uint8_t buffer_index; // next note of the front chunk
 
-    bool needs_loading;
+    volatile bool back_ready; // the back chunk is loaded, only the main loop sets it and only the interrupt clears it
+    volatile bool at_end;     // the back chunk holds the last notes of a sound that doesn't loop
 } s_SoundReader;
 
 typedef struct {
     uint16_t frequency_offset;
     bool looping;
+    volatile bool playing; // the music has notes left, with the buzzer it has the tone unless a sound effect preempted it
 
     s_SoundReader reader;
 } s_Sound;
 
+/*
+ * There are two channels: music and sound effects. The synth plays them on voices of their own (see tone.h), so an
+ * effect plays over the music. The buzzer has a single tone, there a sound effect preempts the music, which keeps its
+ * reader (and so its position in the file) while it waits. When the effect ends the music continues with its next note.
+ * An effect preempts a playing effect of the same or a lower priority, an effect of a lower priority than the playing
+ * one is dropped.
+ * Effects play from RAM (cache_sound_effect), so they start right away and never wait for the SD card.
+*/
+typedef enum {
+    SFX_PRIORITY_LOW,
+    SFX_PRIORITY_NORMAL,
+    SFX_PRIORITY_HIGH,
+} e_SfxPriority;
+
+typedef struct {
+    const char *filename;
+    uint8_t note_count;
+    s_LoadedNote notes[SFX_MAX_NOTES];
+} s_SoundEffect;
+
+// Plays music from flash if it was compiled in (see tracks.h), from the SD card otherwise
 SOUND_EXTERN_C void play_sound(const char *filename, uint16_t frequncy_offset);
 
 SOUND_EXTERN_C void stop_sound_playback(void);
 
+// Loads a sound effect into the cache, from flash or the SD card like play_sound. Call it before the effect is played
+SOUND_EXTERN_C bool cache_sound_effect(const char *filename);
+
+// Plays a cached sound effect over the music, returns false if it isn't cached or a more important effect is playing
+SOUND_EXTERN_C bool play_sound_effect(const char *filename, e_SfxPriority priority);
+
 SOUND_EXTERN_C void update_sound_chunks();
 
 #endif //ATMEGA_GAME_SOUND_H
\ No newline at end of file
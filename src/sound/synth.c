@@ -0,0 +1,249 @@
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <stddef.h>
+#include "synth.h"
+#include "../hardware/Timers/timer0/timer0.h"
+#include "../hardware/Timers/timer2/timer2.h"
+
+#ifdef SYNTH_CONFIG_BENCHMARK
+#include <stdio.h>
+#include <string.h>
+#include "../hardware/uart/uart.h"
+#endif // SYNTH_CONFIG_BENCHMARK
+
+#if SYNTH_CYCLE_BUDGET >= SYNTH_SAMPLE_CYCLES
+#error "SYNTH_CYCLE_BUDGET leaves no time between two samples, lower the sample rate (raise SYNTH_TIMER_TOP)"
+#endif
+
+// The mix of all voices is scaled down so it can't clip
+#define SYNTH_MIX_SHIFT (SYNTH_VOICES > 2 ? 2 : SYNTH_VOICES - 1)
+
+#define SYNTH_OFF 0
+#define SYNTH_ATTACK 1
+#define SYNTH_SUSTAIN 2
+#define SYNTH_RELEASE 3
+
+const int8_t synth_wave_sine[SYNTH_WAVE_SIZE] PROGMEM = {
+    0, 12, 25, 37, 49, 60, 71, 81, 90, 98, 106, 112, 117, 122, 125, 126,
+    127, 126, 125, 122, 117, 112, 106, 98, 90, 81, 71, 60, 49, 37, 25, 12,
+    0, -12, -25, -37, -49, -60, -71, -81, -90, -98, -106, -112, -117, -122, -125, -126,
+    -127, -126, -125, -122, -117, -112, -106, -98, -90, -81, -71, -60, -49, -37, -25, -12,
+};
+
+const int8_t synth_wave_square[SYNTH_WAVE_SIZE] PROGMEM = {
+    127, 127, 127, 127, 127, 127, 127, 127, 127, 127, 127, 127, 127, 127, 127, 127,
+    127, 127, 127, 127, 127, 127, 127, 127, 127, 127, 127, 127, 127, 127, 127, 127,
+    -127, -127, -127, -127, -127, -127, -127, -127, -127, -127, -127, -127, -127, -127, -127, -127,
+    -127, -127, -127, -127, -127, -127, -127, -127, -127, -127, -127, -127, -127, -127, -127, -127,
+};
+
+const int8_t synth_wave_triangle[SYNTH_WAVE_SIZE] PROGMEM = {
+    0, 8, 16, 24, 32, 40, 48, 56, 64, 71, 79, 87, 95, 103, 111, 119,
+    127, 119, 111, 103, 95, 87, 79, 71, 64, 56, 48, 40, 32, 24, 16, 8,
+    0, -8, -16, -24, -32, -40, -48, -56, -64, -71, -79, -87, -95, -103, -111, -119,
+    -127, -119, -111, -103, -95, -87, -79, -71, -64, -56, -48, -40, -32, -24, -16, -8,
+};
+
+const int8_t synth_wave_saw[SYNTH_WAVE_SIZE] PROGMEM = {
+    -127, -123, -119, -115, -111, -107, -103, -99, -95, -91, -87, -83, -79, -75, -71, -67,
+    -62, -58, -54, -50, -46, -42, -38, -34, -30, -26, -22, -18, -14, -10, -6, -2,
+    2, 6, 10, 14, 18, 22, 26, 30, 34, 38, 42, 46, 50, 54, 58, 62,
+    67, 71, 75, 79, 83, 87, 91, 95, 99, 103, 107, 111, 115, 119, 123, 127,
+};
+
+typedef struct {
+    uint16_t phase;
+    uint16_t increment;
+    const int8_t *wave;
+    uint8_t level;    // envelope scaled by the master volume, what the sample is multiplied by
+    uint8_t envelope;
+    uint8_t state;    // SYNTH_OFF, SYNTH_ATTACK, SYNTH_SUSTAIN or SYNTH_RELEASE
+    s_SynthPatch patch;
+} s_SynthVoice;
+
+// Only the sample interrupt changes the voices while they play, the main loop changes them with interrupts off
+static s_SynthVoice voices[SYNTH_VOICES];
+static uint8_t master = 255;
+
+static uint8_t envelope_tick;
+static uint8_t envelope_voice;
+static void (*tick_callback)(void);
+
+// Advances the envelope of a voice by a step
+static void synth_envelope(s_SynthVoice *voice) {
+    switch (voice->state) {
+        case SYNTH_ATTACK: {
+            const uint16_t envelope = voice->envelope + voice->patch.attack;
+            if (voice->patch.attack == 0 || envelope >= voice->patch.volume) {
+                voice->envelope = voice->patch.volume;
+                voice->state = SYNTH_SUSTAIN;
+            } else {
+                voice->envelope = envelope;
+            }
+            break;
+        }
+
+        case SYNTH_RELEASE:
+            if (voice->patch.release == 0 || voice->envelope <= voice->patch.release) {
+                voice->envelope = 0;
+                voice->state = SYNTH_OFF;
+            } else {
+                voice->envelope -= voice->patch.release;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    voice->level = (uint8_t)(((uint16_t)voice->envelope * master) >> 8);
+}
+
+// Renders a sample, the Timer0 compare interrupt
+static void synth_sample(void) {
+    int16_t mix = 0;
+
+    for (uint8_t i = 0; i < SYNTH_VOICES; i++) {
+        s_SynthVoice *voice = &voices[i];
+
+        voice->phase += voice->increment;
+        const int8_t sample = (int8_t)pgm_read_byte(voice->wave + (voice->phase >> (16 - SYNTH_WAVE_BITS)));
+        mix += (int16_t)(sample * voice->level) >> 8;
+    }
+
+    OCR2B = (uint8_t)(128 + (mix >> SYNTH_MIX_SHIFT));
+
+    // one voice's envelope per step, so no sample has to do them all
+    if (++envelope_tick < SYNTH_ENVELOPE_DIVIDER) {
+        return;
+    }
+
+    envelope_tick = 0;
+    synth_envelope(&voices[envelope_voice]);
+    if (++envelope_voice == SYNTH_VOICES) {
+        envelope_voice = 0;
+    }
+
+    if (tick_callback != NULL) {
+        tick_callback();
+    }
+}
+
+void synth_init(void (*tick)(void)) {
+    tick_callback = tick;
+
+    for (uint8_t i = 0; i < SYNTH_VOICES; i++) {
+        voices[i].wave = synth_wave_sine;
+    }
+
+    // 62.5 kHz PWM carrier, far above what the speaker can follow, starting at the midpoint
+    initTimer2(&(s_TIM2_CONFIG) {
+        .compareOutputModeA = TIM2_DisconnectedOC2ACompareMatch,
+        .compareOutputModeB = TIM2_ClearOC2BCompareMatch,
+        .waveformGenerationMode = TIM2_MODE_3,
+        .clockSource = TIM2_CLOCK_DEFAULT,
+        .CompBMatchInterruptCallback = NULL,
+        .CompAMatchInterruptCallback = NULL,
+        .TimerOverflowInterruptCallback = NULL,
+    });
+    setOCR2B(128);
+
+    initTimer0(&(s_TIM0_CONFIG) {
+        .compareOutputModeA = TIM0_DisconnectedOC1ACompareMatch,
+        .compareOutputModeB = TIM0_DisconnectedOC1BCompareMatch,
+        .waveformGenerationMode = TIM0_MODE_2,
+        .clockSource = TIM0_CLOCK_PRESCALER_8,
+        .CompBMatchInterruptCallback = NULL,
+        .CompAMatchInterruptCallback = synth_sample,
+        .TimerOverflowInterruptCallback = NULL,
+    });
+    setOCR0A(SYNTH_TIMER_TOP);
+
+    DDRD |= (1 << DDD3);
+}
+
+uint16_t synth_increment(uint16_t frequency) {
+    return (uint16_t)(((uint32_t)frequency << 16) / SYNTH_SAMPLE_RATE);
+}
+
+void synth_note_on(uint8_t voice, uint16_t increment, const s_SynthPatch *patch) {
+    uint8_t sreg = SREG;
+    cli();
+
+    s_SynthVoice *v = &voices[voice];
+    v->patch = *patch;
+    v->wave = patch->wave;
+    v->increment = increment;
+    v->envelope = 0;
+    v->state = SYNTH_ATTACK;
+
+    // the first step is taken right away, so a note without attack starts at its peak with the next sample
+    synth_envelope(v);
+
+    SREG = sreg;
+}
+
+void synth_note_off(uint8_t voice) {
+    uint8_t sreg = SREG;
+    cli();
+
+    if (voices[voice].state != SYNTH_OFF) {
+        voices[voice].state = SYNTH_RELEASE;
+    }
+
+    SREG = sreg;
+}
+
+bool synth_voice_idle(uint8_t voice) {
+    return voices[voice].state == SYNTH_OFF;
+}
+
+void synth_set_master(uint8_t volume) {
+    // the levels follow with their next envelope step
+    master = volume;
+}
+
+#ifdef SYNTH_CONFIG_BENCHMARK
+/*
+Times the sample function with Timer1 (the scheduler's millisecond timer, prescaler 64) while every voice plays.
+32 samples at 64 cycles per timer count make the counter difference half the cycles per sample.
+The interrupt entry and exit (about 40 cycles for the callback through timer0.c) come on top.
+*/
+void synth_benchmark(void) {
+    static const s_SynthPatch patch = { synth_wave_saw, 255, 0, 0 };
+    for (uint8_t i = 0; i < SYNTH_VOICES; i++) {
+        synth_note_on(i, synth_increment(440 + i * 110), &patch);
+    }
+
+    const uint8_t sreg = SREG;
+    cli();
+
+    const uint16_t period = OCR1A + 1;
+    const uint16_t start = TCNT1;
+    for (uint8_t i = 0; i < 32; i++) {
+        synth_sample();
+    }
+    const uint16_t end = TCNT1;
+
+    // the slowest sample, which steps an envelope and calls the tick
+    envelope_tick = SYNTH_ENVELOPE_DIVIDER - 1;
+    const uint16_t slow_start = TCNT1;
+    synth_sample();
+    const uint16_t slow_end = TCNT1;
+
+    SREG = sreg;
+
+    for (uint8_t i = 0; i < SYNTH_VOICES; i++) {
+        synth_note_off(i);
+    }
+
+    const uint16_t average = ((end + period - start) % period) * 2;
+    const uint16_t slowest = ((slow_end + period - slow_start) % period) * 64;
+
+    char msg[96];
+    snprintf(msg, sizeof(msg), "synth: %u cycles/sample, slowest %u (+-64), budget %u of %u\n",
+             average, slowest, SYNTH_CYCLE_BUDGET, SYNTH_SAMPLE_CYCLES);
+    sendUartData(msg, strlen(msg));
+}
+#endif // SYNTH_CONFIG_BENCHMARK
@@ -0,0 +1,89 @@
+#ifndef ATMEGA_GAME_SYNTH_H
+#define ATMEGA_GAME_SYNTH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "../../lib/system.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Wavetable synthesizer, used as the sound backend when SOUND_CONFIG_SYNTH is defined (see tone.h).
+ * Timer2 runs fast PWM at 62.5 kHz on OC2B, the speaker pin. Timer0 interrupts at the sample rate, every interrupt
+ * advances the phase accumulator of every voice, looks its sample up in its PROGMEM wavetable, scales it by the voice's
+ * envelope, and writes the mix to OCR2B. Every voice is mixed, playing or not, so an interrupt always costs the same.
+ * Every SYNTH_ENVELOPE_DIVIDER samples one voice's envelope is advanced and the tick callback is called.
+*/
+
+#ifndef SYNTH_VOICES
+#define SYNTH_VOICES 3
+#endif // SYNTH_VOICES
+
+// Timer0 in CTC mode with prescaler 8: FREQ_CPU / 8 / (SYNTH_TIMER_TOP + 1) samples per second
+#ifndef SYNTH_TIMER_TOP
+#define SYNTH_TIMER_TOP 127
+#endif // SYNTH_TIMER_TOP
+
+#define SYNTH_SAMPLE_RATE (FREQ_CPU / 8 / (SYNTH_TIMER_TOP + 1))
+
+// CPU cycles between two samples, the sample interrupt has to stay well within this
+#define SYNTH_SAMPLE_CYCLES (8 * (SYNTH_TIMER_TOP + 1))
+
+// Cycles the sample function may take (mixing, an envelope step and the tick), see synth_benchmark
+#ifndef SYNTH_CYCLE_BUDGET
+#define SYNTH_CYCLE_BUDGET 320
+#endif // SYNTH_CYCLE_BUDGET
+
+// Samples between two envelope steps (of a single voice, the voices take turns) and two tick callbacks
+#ifndef SYNTH_ENVELOPE_DIVIDER
+#define SYNTH_ENVELOPE_DIVIDER 16
+#endif // SYNTH_ENVELOPE_DIVIDER
+
+// Samples per wavetable, a power of two
+#define SYNTH_WAVE_BITS 6
+#define SYNTH_WAVE_SIZE (1 << SYNTH_WAVE_BITS)
+
+// Wavetables of SYNTH_WAVE_SIZE signed samples, in PROGMEM
+extern const int8_t synth_wave_sine[];
+extern const int8_t synth_wave_square[];
+extern const int8_t synth_wave_triangle[];
+extern const int8_t synth_wave_saw[];
+
+// How a voice sounds
+typedef struct {
+    const int8_t *wave; // one of the synth_wave_* tables
+    uint8_t volume;     // envelope peak
+    uint8_t attack;     // envelope rise per envelope step, 0 starts at the peak
+    uint8_t release;    // envelope fall per envelope step after synth_note_off, 0 stops at once
+} s_SynthPatch;
+
+// Takes over Timer0 and Timer2, tick is called from the sample interrupt every SYNTH_ENVELOPE_DIVIDER samples
+void synth_init(void (*tick)(void));
+
+// Gets the phase increment of a frequency, this is a division so do it outside of interrupts
+uint16_t synth_increment(uint16_t frequency);
+
+// Starts a note on a voice, cutting off the note it was playing
+void synth_note_on(uint8_t voice, uint16_t increment, const s_SynthPatch *patch);
+
+// Lets the note of a voice fade out with the release of its patch
+void synth_note_off(uint8_t voice);
+
+// Whether a voice is silent
+bool synth_voice_idle(uint8_t voice);
+
+// Scales every voice, the sound is muted at 0
+void synth_set_master(uint8_t volume);
+
+#ifdef SYNTH_CONFIG_BENCHMARK
+// Measures the cycles a sample takes with every voice playing, prints it and the budget over UART
+void synth_benchmark(void);
+#endif // SYNTH_CONFIG_BENCHMARK
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //ATMEGA_GAME_SYNTH_H
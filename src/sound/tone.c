@@ -18,13 +18,20 @@
 static volatile bool buzzerEnabled = false;
 bool playing_tone = false;
 
-volatile uint32_t toneStartTime = 0;
-volatile uint16_t toneDuration = 0;
-static void (* volatile toneDoneCallback)() = NULL;
+volatile uint32_t toneStartTime[TONE_CHANNELS];
+volatile uint16_t toneDuration[TONE_CHANNELS];
+static void (* volatile toneDoneCallback[TONE_CHANNELS])();
 
 volatile e_TIM0_ClockSource timer0_stored_prescaler = (e_TIM0_ClockSource)0;
 
+#ifdef SOUND_CONFIG_SYNTH
+// Tones sound like the buzzer, a square wave, with a short release so notes don't click
+static const s_SynthPatch tonePatch = { synth_wave_square, 255, 0, 64 };
+#endif // SOUND_CONFIG_SYNTH
+
+// With the synth this is its tick instead of the Timer0 interrupt, it then only times the tones
 void timer0CompareCallback(void) {
+#ifndef SOUND_CONFIG_SYNTH
     if (playing_tone) {
         buzzerEnabled = !buzzerEnabled;
         if (buzzerEnabled) {
@@ -37,33 +44,41 @@ void timer0CompareCallback(void) {
             setCompareOutputModeBTimer2(TIM2_ClearOC2BCompareMatch);
         }
     }
+#endif // SOUND_CONFIG_SYNTH
 
-    if (toneDuration == 0) {
-        return;
-    }
+    for (uint8_t channel = 0; channel < TONE_CHANNELS; channel++) {
+        if (toneDuration[channel] == 0) {
+            continue;
+        }
 
-    if (scheduler_millis() - toneStartTime >= toneDuration && toneDoneCallback != NULL) {
-        toneDuration = 0;
-        toneDoneCallback();
+        if (scheduler_millis() - toneStartTime[channel] >= toneDuration[channel] && toneDoneCallback[channel] != NULL) {
+            toneDuration[channel] = 0;
+            toneDoneCallback[channel]();
+        }
     }
 }
 
 void setVolume(uint8_t volume) {
+#ifdef SOUND_CONFIG_SYNTH
+    synth_set_master(volume);
+#else
     setOCR2B(volume);
+#endif // SOUND_CONFIG_SYNTH
 }
 
-void playTone(uint16_t frequency, uint16_t duration, void (*toneCallback)()) {
-    toneDoneCallback = toneCallback;
-    toneStartTime = scheduler_millis();
-    toneDuration = duration;
-
-    playing_tone = frequency != 0;
+s_ToneTimer resolveTone(uint16_t frequency) {
+#ifdef SOUND_CONFIG_SYNTH
+    s_ToneTimer timer = { synth_increment(frequency) };
+    return timer;
+#else
+    s_ToneTimer timer = {0, 0};
     if (frequency == 0) {
-        return;
+        return timer;
     }
 
-    const uint32_t prescalers[] = {1, 8, 64, 256, 1024};
-    const e_TIM0_ClockSource prescalerCodes[] = {
+    // The prescalers (1, 8, 64, 256, 1024) are powers of two, so a single division gives the top for all of them
+    static const uint8_t prescalerShifts[] = {0, 3, 6, 8, 10};
+    static const e_TIM0_ClockSource prescalerCodes[] = {
         TIM0_CLOCK_DEFAULT,
         TIM0_CLOCK_PRESCALER_8,
         TIM0_CLOCK_PRESCALER_64,
@@ -71,23 +86,64 @@ void playTone(uint16_t frequency, uint16_t duration, void (*toneCallback)()) {
         TIM0_CLOCK_PRESCALER_1024
     };
 
+    const uint32_t cycles = FREQ_CPU / (2UL * frequency);
+
     uint8_t prescalerIndex = 0;
     uint16_t top = 0;
     for (uint8_t i = 0; i < 5; i++) {
-        top = (FREQ_CPU / (2 * prescalers[i] * frequency)) - 1;
+        top = (cycles >> prescalerShifts[i]) - 1;
         prescalerIndex = i;
         if (top < 150) {
             break;
         }
     }
 
-    timer0_stored_prescaler = prescalerCodes[prescalerIndex];
-    setTimer0ClockSource(prescalerCodes[prescalerIndex]);
+    timer.clockSource = prescalerCodes[prescalerIndex];
+    timer.top = top;
+    return timer;
+#endif // SOUND_CONFIG_SYNTH
+}
+
+void playResolvedToneOn(uint8_t channel, s_ToneTimer timer, uint16_t duration, void (*toneCallback)()) {
+    toneDoneCallback[channel] = toneCallback;
+    toneStartTime[channel] = scheduler_millis();
+    toneDuration[channel] = duration;
 
-    setOCR0A(top);
+#ifdef SOUND_CONFIG_SYNTH
+    if (timer.increment != 0) {
+        synth_note_on(TONE_SYNTH_VOICE + channel, timer.increment, &tonePatch);
+    } else {
+        synth_note_off(TONE_SYNTH_VOICE + channel);
+    }
+#else
+    playing_tone = timer.clockSource != 0;
+    if (!playing_tone) {
+        return;
+    }
+
+    timer0_stored_prescaler = (e_TIM0_ClockSource)timer.clockSource;
+    setTimer0ClockSource((e_TIM0_ClockSource)timer.clockSource);
+
+    setOCR0A(timer.top);
+#endif // SOUND_CONFIG_SYNTH
+}
+
+void playToneOn(uint8_t channel, uint16_t frequency, uint16_t duration, void (*toneCallback)()) {
+    playResolvedToneOn(channel, resolveTone(frequency), duration, toneCallback);
+}
+
+void playResolvedTone(s_ToneTimer timer, uint16_t duration, void (*toneCallback)()) {
+    playResolvedToneOn(TONE_MUSIC_CHANNEL, timer, duration, toneCallback);
+}
+
+void playTone(uint16_t frequency, uint16_t duration, void (*toneCallback)()) {
+    playToneOn(TONE_MUSIC_CHANNEL, frequency, duration, toneCallback);
 }
 
 void initTone(void) {
+#ifdef SOUND_CONFIG_SYNTH
+    synth_init(timer0CompareCallback);
+#else
     initTimer0(&(s_TIM0_CONFIG) {
         .compareOutputModeA = TIM0_DisconnectedOC1ACompareMatch,
         .compareOutputModeB = TIM0_DisconnectedOC1BCompareMatch,
@@ -110,4 +166,5 @@ void initTone(void) {
     });
 
     DDRD |= (1 << DDD3);
+#endif // SOUND_CONFIG_SYNTH
 }
\ No newline at end of file
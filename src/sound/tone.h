@@ -7,14 +7,60 @@
 
 #include <stdint.h>
 
+// Define SOUND_CONFIG_SYNTH to play tones on the wavetable synthesizer (synth.h) instead of gating the Timer2 PWM.
+// The buzzer plays a single tone. The synth plays a tone per channel at the same time, channel n on voice
+// TONE_SYNTH_VOICE + n: the music on TONE_MUSIC_CHANNEL and sound effects on TONE_SFX_CHANNEL (see sound.h)
+#ifdef SOUND_CONFIG_SYNTH
+#include "synth.h"
+
+#ifndef TONE_SYNTH_VOICE
+#define TONE_SYNTH_VOICE 0
+#endif // TONE_SYNTH_VOICE
+
+#define TONE_CHANNELS 2
+#define TONE_SFX_CHANNEL 1
+
+#if TONE_SYNTH_VOICE + TONE_CHANNELS > SYNTH_VOICES
+#error "Every tone channel needs a synth voice, lower TONE_SYNTH_VOICE or raise SYNTH_VOICES"
+#endif
+#else
+#define TONE_CHANNELS 1
+// sound effects take the tone from the music
+#define TONE_SFX_CHANNEL 0
+#endif // SOUND_CONFIG_SYNTH
+
+#define TONE_MUSIC_CHANNEL 0
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+    // A frequency resolved to Timer0 settings, playing it is a couple of register writes
+    typedef struct {
+#ifdef SOUND_CONFIG_SYNTH
+        uint16_t increment;  // phase increment of the synth voice, 0 for silence
+#else
+        uint8_t clockSource; // e_TIM0_ClockSource, 0 for silence
+        uint8_t top;         // OCR0A
+#endif // SOUND_CONFIG_SYNTH
+    } s_ToneTimer;
+
     void timer0CompareCallback(void);
 
     void setVolume(uint8_t volume);
 
+    // Resolves a frequency to Timer0 settings, this takes a 32-bit division so do it outside of interrupts
+    s_ToneTimer resolveTone(uint16_t frequency);
+
+    // Plays a tone on a channel (cutting off the one it played), toneCallback is called from the interrupt once the
+    // duration is over
+    void playResolvedToneOn(uint8_t channel, s_ToneTimer timer, uint16_t duration, void (*toneCallback)());
+
+    void playToneOn(uint8_t channel, uint16_t frequency, uint16_t duration, void (*toneCallback)());
+
+    // Plays a tone on TONE_MUSIC_CHANNEL
+    void playResolvedTone(s_ToneTimer timer, uint16_t duration, void (*toneCallback)());
+
     void playTone(uint16_t frequency, uint16_t duration, void (*toneCallback)());
 
     void initTone(void);
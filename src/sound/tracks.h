@@ -0,0 +1,26 @@
+#ifndef ATMEGA_GAME_TRACKS_H
+#define ATMEGA_GAME_TRACKS_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Sound tracks compiled into flash, tracks.c is generated before every build by misc/sound_tracks.py.
+ * The data is a whole sfd file (see sound.h) in PROGMEM, so it is read with the pgm_read functions.
+*/
+typedef struct {
+    const char *name; // the name of the sound on the SD card (see resources.h)
+    const uint8_t *data;
+} s_FlashTrack;
+
+extern const s_FlashTrack flash_tracks[];
+extern const uint8_t flash_track_count;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //ATMEGA_GAME_TRACKS_H
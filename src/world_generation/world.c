@@ -1,4 +1,6 @@
 #include "world.h"
+#include <stddef.h>
+#include <string.h>
 #include "resources.h"
 #include "game/game_state.h"
 
@@ -10,6 +12,8 @@
 #define STONE_CHANCE 35
 #define TRAP_ROW_1 4
 #define TRAP_ROW_2 7
+/* Rijen die de runner voor zich in beeld houdt, verder schuift het beeld mee (world_follow) */
+#define WORLD_VIEW_AHEAD 2
 
 /* =========================================================
    BITMAPS
@@ -26,6 +30,14 @@ static gfx_tilemap_t world_map = {
     {0}
 };
 
+/* Traps liggen op een eigen laag boven de grond, zodat de grond eronder bewaard blijft. Lege soorten zijn leeg,
+   een trap bedekt zijn tegel helemaal dus de grond eronder hoeft niet getekend te worden */
+static gfx_tilemap_t trap_map = {
+    GFX_DIRTY_BIT | GFX_OPAQUE_BIT,
+    {NULL, NULL, &bmp_spike_inactive, NULL, &bmp_spike_active},
+    {0}
+};
+
 /* =========================================================
    PRNG
    ========================================================= */
@@ -52,76 +64,147 @@ void world_set_seed(uint32_t seed) {
    WORLD GENERATION LOGIC
    ========================================================= */
 
-void world_generate_new(void) {
-    int path_x = get_fixed_random(1, GFX_TILEMAP_WIDTH - 2); // Pad iets minder aan rand
+static int path_x;
 
-    for (int y = GFX_TILEMAP_HEIGHT - 1; y >= 0; y--)
-    {
-        /* Pad loopt door */
-        int r_dir = get_fixed_random(0, 3);
-        path_x += (r_dir - 1);
+/* Genereert wereldrij y in de ringbuffer van de tilemap, de rij moet in beeld zijn */
+static void world_generate_row(int y)
+{
+    uint8_t *tiles = gfx_tilemap_row(&world_map, y);
+    uint8_t *traps = gfx_tilemap_row(&trap_map, y);
+    uint8_t *flags = &tile_flags[WORLD_TILE_INDEX(0, y)];
 
-        if (path_x < 1)
-            path_x = 1;
-        if (path_x > GFX_TILEMAP_WIDTH - 3)
-            path_x = GFX_TILEMAP_WIDTH - 3; // Iets meer ruimte rechts
+    /* Het patroon van veilige zones en traps herhaalt zich iedere schermhoogte */
+    int level_y = GFX_TILEMAP_RING_ROW(y);
 
-        for (int x = 0; x < GFX_TILEMAP_WIDTH; x++)
-        {
-            uint8_t tile = TILE_GRASS;
+    /* Pad loopt door */
+    int r_dir = get_fixed_random(0, 3);
+    path_x += (r_dir - 1);
 
-            bool safe_zone_bottom = (y < 3);
-            bool safe_zone_top = (y >= GFX_TILEMAP_HEIGHT - 3);
-            bool is_trap_row = (y == TRAP_ROW_1 || y == TRAP_ROW_2);
+    if (path_x < 1)
+        path_x = 1;
+    if (path_x > GFX_TILEMAP_WIDTH - 3)
+        path_x = GFX_TILEMAP_WIDTH - 3; // Iets meer ruimte rechts
 
-            if (safe_zone_bottom || safe_zone_top)
-            {
-                tile = TILE_GRASS;
-            }
-            else if (is_trap_row)
+    for (int x = 0; x < GFX_TILEMAP_WIDTH; x++)
+    {
+        uint8_t tile = TILE_GRASS;
+        uint8_t trap = TILE_GRASS;
+
+        /* Een hergebruikte rij mag geen vlaggen van de vorige rij houden */
+        flags[x] = 0;
+
+        bool safe_zone_bottom = (level_y < 3);
+        bool safe_zone_top = (level_y >= GFX_TILEMAP_HEIGHT - 3);
+        bool is_trap_row = (level_y == TRAP_ROW_1 || level_y == TRAP_ROW_2);
+
+        if (safe_zone_bottom || safe_zone_top)
+        {
+            tile = TILE_GRASS;
+        }
+        else if (is_trap_row)
+        {
+            /* Muur van traps, op gras */
+            trap = TILE_TILE;
+        }
+        else
+        {
+            /* === VEILIG PAD LOGICA === */
+            /* We maken het pad nu 2 tegels breed (x en x+1) */
+            /* Of we checken gewoon of x dichtbij path_x is */
+            if (x == path_x)
             {
-                /* Muur van traps */
-                tile = TILE_TILE;
+                tile = TILE_GRASS; /* Altijd begaanbaar */
             }
             else
             {
-                /* === VEILIG PAD LOGICA === */
-                /* We maken het pad nu 2 tegels breed (x en x+1) */
-                /* Of we checken gewoon of x dichtbij path_x is */
-                if (x == path_x)
-                {
-                    tile = TILE_GRASS; /* Altijd begaanbaar */
+                /* Random obstakels */
+                int r = get_fixed_random(0, 100);
+                if (r < WATER_CHANCE) {
+                    tile = TILE_WATER;
+                    flags[x] |= TILE_DEADLY_FLAG;
+                }
+                else if (r < STONE_CHANCE) {
+                    tile = TILE_STONE;
+                    flags[x] |= TILE_INACCESSIBLE_FLAG;
                 }
-                else
-                {
-                    // Clear tile flags
-                    tile_flags[y * GFX_TILEMAP_WIDTH + x] = 0;
-
-                    /* Random obstakels */
-                    int r = get_fixed_random(0, 100);
-                    if (r < WATER_CHANCE) {
-                        tile = TILE_WATER;
-                        tile_flags[y * GFX_TILEMAP_WIDTH + x] |= TILE_DEADLY_FLAG;
-                    }
-                    else if (r < STONE_CHANCE) {
-                        tile = TILE_STONE;
-                        tile_flags[y * GFX_TILEMAP_WIDTH + x] |= TILE_INACCESSIBLE_FLAG;
-                    }
-                    else {
-                        tile = TILE_GRASS;
-                    }
+                else {
+                    tile = TILE_GRASS;
                 }
             }
-
-            world_map.tiles[y * GFX_TILEMAP_WIDTH + x] = tile;
         }
+
+        tiles[x] = tile;
+        traps[x] = trap;
     }
+}
 
+static void world_generate_tiles(void) {
+    /* Ieder level begint weer bovenaan de wereld */
+    world_map.top = 0;
+    trap_map.top = 0;
+    path_x = get_fixed_random(1, GFX_TILEMAP_WIDTH - 2); // Pad iets minder aan rand
+
+    for (int y = GFX_TILEMAP_HEIGHT - 1; y >= 0; y--)
+        world_generate_row(y);
+}
+
+void world_generate_new(void) {
+    world_generate_tiles();
     world_map.flags |= GFX_DIRTY_BIT;
 }
 
 void world_next_level(void) {
-    world_generate_new();
+    /* Alleen tegels die veranderen worden opnieuw getekend, een volledige redraw is voor scene wissels */
+    uint8_t previous[GFX_TILEMAP_WIDTH * GFX_TILEMAP_HEIGHT];
+    uint8_t previous_traps[GFX_TILEMAP_WIDTH * GFX_TILEMAP_HEIGHT];
+    memcpy(previous, world_map.tiles, sizeof(previous));
+    memcpy(previous_traps, trap_map.tiles, sizeof(previous_traps));
+    int16_t previous_top = world_map.top;
+
+    world_generate_tiles();
+
+    /* Het beeld was opgeschoven, alle tegels staan ergens anders */
+    if (previous_top != 0)
+    {
+        gfx_invalidate_tilemap(&world_map);
+        return;
+    }
+
+    for (int y = 0; y < GFX_TILEMAP_HEIGHT; y++)
+    {
+        for (int x = 0; x < GFX_TILEMAP_WIDTH; x++)
+        {
+            int i = WORLD_TILE_INDEX(x, y);
+            if (previous[i] != world_map.tiles[i] || previous_traps[i] != trap_map.tiles[i])
+                gfx_invalidate_tile(&world_map, x, y);
+        }
+    }
+}
+
+void world_scroll_next_level(void) {
+    /* Het nieuwe level schuift van onder in beeld, het scherm wordt nooit helemaal opnieuw getekend */
+    world_generate_tiles();
+    gfx_scroll_transition();
+}
+
+void world_advance(void) {
+    /* De bovenste rij valt uit beeld, zijn plek in de ringbuffer wordt de nieuwe onderste rij.
+       Alleen de tegels die er anders uitzien en de nieuwe rij worden opnieuw getekend */
+    gfx_set_viewport(&world_map, world_map.top + 1);
+    gfx_set_viewport(&trap_map, trap_map.top + 1);
+    world_generate_row(world_map.top + GFX_TILEMAP_HEIGHT - 1);
+}
+
+bool world_follow(int16_t y) {
+    bool moved = false;
+
+    while (y > world_map.top + GFX_TILEMAP_HEIGHT - 1 - WORLD_VIEW_AHEAD)
+    {
+        world_advance();
+        moved = true;
+    }
+
+    return moved;
 }
 
 void world_init(void) {
@@ -137,4 +220,8 @@ void world_init(void) {
 
 gfx_tilemap_t *world_get_tilemap(void) {
     return &world_map;
+}
+
+gfx_tilemap_t *world_get_trap_tilemap(void) {
+    return &trap_map;
 }
\ No newline at end of file
@@ -15,10 +15,15 @@
 
 uint8_t tile_flags[GFX_TILEMAP_WIDTH * GFX_TILEMAP_HEIGHT];
 
+/* Index van wereldtegel (x, y) in tile_flags en de tegels van de tilemap, die een ringbuffer van rijen zijn */
+#define WORLD_TILE_INDEX(x, y) (GFX_TILEMAP_RING_ROW(y) * GFX_TILEMAP_WIDTH + (x))
+
 /* World module API */
 void world_generate_new(void);
 void world_init(void);
 gfx_tilemap_t *world_get_tilemap(void);
+/* Laag met de traps, boven de grond van world_get_tilemap */
+gfx_tilemap_t *world_get_trap_tilemap(void);
 
 /* Seed control for reproducible generation */
 void world_set_seed(uint32_t seed);
@@ -28,6 +33,15 @@ gfx_vec2_t world_get_spawn_tile(void);
 void world_regenerate_and_respawn(gfx_sprite_t *player);
 bool world_is_regenerating(void);
 
+/* Nieuw level, alleen de tegels die veranderen worden opnieuw getekend */
 void world_next_level(void);
+/* Nieuw level dat van onder in beeld schuift (hardware scroll), voor als het hele scherm verandert */
+void world_scroll_next_level(void);
+
+/* Schuift het beeld een rij op en genereert de rij die in beeld komt */
+void world_advance(void);
+/* Schuift het beeld op zolang rij y te dicht bij de onderkant van het beeld ligt, geeft terug of het beeld is opgeschoven.
+   Beide spelers volgen de runner, zodat ze dezelfde rijen genereren */
+bool world_follow(int16_t y);
 
 #endif /* WORLD_H */
\ No newline at end of file
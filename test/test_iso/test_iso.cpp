@@ -0,0 +1,69 @@
+// Host test for the integer isometric transform in gfx/iso.h, run it with: pio test -e native
+#include <math.h>
+#include <stdio.h>
+#include <unity.h>
+
+#include "gfx/iso.h"
+
+// Pixels around the screen that are checked, well past its edges in every direction
+#define ISO_TEST_MIN_X (-600)
+#define ISO_TEST_MAX_X 900
+#define ISO_TEST_MIN_Y (-600)
+#define ISO_TEST_MAX_Y 1000
+
+// The float transform gfx_screen_to_world used before it was integer (tft.width() and tft.height() were the screen size)
+static gfx_vec2_t float_screen_to_world(const int16_t x, const int16_t y) {
+    const float centered_x = x - (GFX_SCREEN_WIDTH);
+    const float centered_y = y - (GFX_SCREEN_HEIGHT / 4.0f);
+
+    const float fx = (centered_x / GFX_TILEMP_TILE_HALF_WIDTH + centered_y / GFX_TILEMP_TILE_HALF_HEIGHT) * 0.5f;
+    const float fy = (centered_y / GFX_TILEMP_TILE_HALF_HEIGHT - centered_x / GFX_TILEMP_TILE_HALF_WIDTH) * 0.5f;
+
+    return (gfx_vec2_t){
+        .x = (int16_t)floorf(fx),
+        .y = (int16_t)floorf(fy)
+    };
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+// Every pixel maps to the same tile as with the float transform
+static void test_screen_to_world_matches_float(void) {
+    for (int16_t y = ISO_TEST_MIN_Y; y < ISO_TEST_MAX_Y; y++) {
+        for (int16_t x = ISO_TEST_MIN_X; x < ISO_TEST_MAX_X; x++) {
+            const gfx_vec2_t expected = float_screen_to_world(x, y);
+            const gfx_vec2_t actual = gfx_iso_screen_to_world(x, y);
+
+            if (expected.x != actual.x || expected.y != actual.y) {
+                char msg[64];
+                snprintf(msg, sizeof(msg), "pixel (%d, %d)", x, y);
+                TEST_ASSERT_EQUAL_INT16_MESSAGE(expected.x, actual.x, msg);
+                TEST_ASSERT_EQUAL_INT16_MESSAGE(expected.y, actual.y, msg);
+            }
+        }
+    }
+}
+
+// The top corner of a tile maps back to that tile
+static void test_world_to_screen_round_trip(void) {
+    for (int16_t ty = -GFX_TILEMAP_HEIGHT; ty < 2 * GFX_TILEMAP_HEIGHT; ty++) {
+        for (int16_t tx = -GFX_TILEMAP_WIDTH; tx < 2 * GFX_TILEMAP_WIDTH; tx++) {
+            const gfx_vec2_t corner = gfx_iso_world_to_screen(tx, ty);
+            const gfx_vec2_t tile = gfx_iso_screen_to_world(corner.x, corner.y);
+
+            TEST_ASSERT_EQUAL_INT16(tx, tile.x);
+            TEST_ASSERT_EQUAL_INT16(ty, tile.y);
+        }
+    }
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_screen_to_world_matches_float);
+    RUN_TEST(test_world_to_screen_round_trip);
+    return UNITY_END();
+}